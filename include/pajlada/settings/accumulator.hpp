@@ -0,0 +1,301 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <pajlada/settings/detail/timerwheel.hpp>
+#include <pajlada/settings/setting.hpp>
+#include <pajlada/signals/scoped-connection.hpp>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+namespace pajlada::Settings {
+
+namespace detail {
+
+// The shard of the calling thread, threads are spread over the shards
+// round-robin
+inline std::size_t
+accumulatorShard()
+{
+    static std::atomic<std::size_t> nextShard{0};
+    thread_local std::size_t shard =
+        nextShard.fetch_add(1, std::memory_order_relaxed);
+
+    return shard;
+}
+
+}  // namespace detail
+
+/// @brief A numeric setting for values that change at a high rate, like
+/// usage statistics
+///
+/// `add` only adds to an atomic counter of the calling thread's shard, on its
+/// own cache line. The counters are folded into the value of the setting:
+/// - when `fold` is called,
+/// - when the manager is about to save,
+/// - at most once per flush interval while there are counts pending (if an
+///   interval is given),
+/// - when the accumulator is destroyed.
+///
+/// Settings and connections of the same path are only notified per fold.
+/// `get` returns the folded value plus what's still pending, a fold running
+/// at the same time never makes it count anything twice or lose anything.
+template <typename Type>
+class Accumulator
+{
+    static_assert(std::is_arithmetic_v<Type> && !std::is_same_v<Type, bool>,
+                  "Accumulators only work with numeric types");
+
+public:
+    static constexpr std::size_t NUM_SHARDS = 16;
+
+    explicit Accumulator(
+        const std::string &path,
+        std::shared_ptr<SettingManager> instance = nullptr,
+        std::chrono::milliseconds flushInterval = std::chrono::milliseconds(0))
+        : state(std::make_shared<State>(path, instance, flushInterval))
+    {
+        if (!instance) {
+            instance = SettingManager::getInstance();
+        }
+
+        std::weak_ptr<State> weakState = this->state;
+        this->saveConnection = instance->aboutToSave.connect([weakState] {
+            if (auto state = weakState.lock()) {
+                state->fold();
+            }
+        });
+    }
+
+    ~Accumulator()
+    {
+        this->state->fold();
+    }
+
+    Accumulator(const Accumulator &) = delete;
+    Accumulator &operator=(const Accumulator &) = delete;
+
+    void
+    add(Type delta)
+    {
+        auto &shard =
+            this->state->shards[detail::accumulatorShard() % NUM_SHARDS];
+        shard.value.fetch_add(delta, std::memory_order_relaxed);
+
+        Accumulator::armTimer(this->state);
+    }
+
+    Accumulator &
+    operator+=(Type delta)
+    {
+        this->add(delta);
+
+        return *this;
+    }
+
+    Accumulator &
+    operator++()
+    {
+        this->add(Type(1));
+
+        return *this;
+    }
+
+    Type
+    get() const
+    {
+        return this->state->get();
+    }
+
+    /// Add the pending counts to the value of the setting
+    void
+    fold()
+    {
+        this->state->fold();
+    }
+
+    const std::string &
+    getPath() const
+    {
+        return this->state->writer.getPath();
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<Type> value{};
+    };
+
+    struct State {
+        State(const std::string &path, std::shared_ptr<SettingManager> instance,
+              std::chrono::milliseconds _flushInterval)
+            : setting(path, instance)
+            , writer(path, std::move(instance))
+            , flushInterval(_flushInterval)
+        {
+        }
+
+        Type
+        pending() const
+        {
+            Type sum{};
+            for (const auto &shard : this->shards) {
+                sum += shard.value.load(std::memory_order_relaxed);
+            }
+
+            return sum;
+        }
+
+        // A seqlock read of the value and the pending counts, see
+        // `foldSequence`
+        Type
+        get()
+        {
+            while (true) {
+                auto sequence =
+                    this->foldSequence.load(std::memory_order_acquire);
+
+                Type value{};
+                switch (sequence % 4) {
+                    case 0: {
+                        std::lock_guard<std::mutex> lock(this->readMutex);
+
+                        value = this->setting.getValue();
+                    }
+                    break;
+
+                    case 2:
+                        value = this->folded.load(std::memory_order_relaxed);
+                        break;
+
+                    default:
+                        // Counts are being moved, which takes no time
+                        std::this_thread::yield();
+                        continue;
+                }
+                value += this->pending();
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (this->foldSequence.load(std::memory_order_relaxed) ==
+                    sequence) {
+                    return value;
+                }
+            }
+        }
+
+        void
+        fold()
+        {
+            if (this->foldingThread.load(std::memory_order_relaxed) ==
+                std::this_thread::get_id()) {
+                // From a notification of our own fold, the next fold picks
+                // the counts up
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(this->foldMutex);
+            this->foldingThread.store(std::this_thread::get_id(),
+                                      std::memory_order_relaxed);
+
+            auto base = this->writer.getValue();
+
+            this->enterFoldPhase();  // 1: taking the counts
+
+            Type sum{};
+            for (auto &shard : this->shards) {
+                sum += shard.value.exchange(Type{}, std::memory_order_acq_rel);
+            }
+
+            if (sum == Type{}) {
+                this->enterFoldPhase();
+                this->enterFoldPhase();
+                this->enterFoldPhase();
+                this->foldingThread.store({}, std::memory_order_relaxed);
+                return;
+            }
+
+            this->folded.store(base + sum, std::memory_order_relaxed);
+
+            this->enterFoldPhase();  // 2: updating the setting
+
+            auto next = this->writer.update([sum](const Type &value) -> Type {
+                return value + sum;
+            });
+
+            this->enterFoldPhase();  // 3: putting the counts back
+
+            if (!next) {
+                // Couldn't be written (e.g. the manager is frozen), keep it
+                // for the next fold
+                this->shards[0].value.fetch_add(sum,
+                                                std::memory_order_relaxed);
+            }
+
+            this->enterFoldPhase();  // 0: done
+            this->foldingThread.store({}, std::memory_order_relaxed);
+        }
+
+        // Must be called with `foldMutex` held
+        void
+        enterFoldPhase()
+        {
+            this->foldSequence.fetch_add(1, std::memory_order_release);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+
+        // Read by `get`, guarded by `readMutex`
+        Setting<Type> setting;
+        // Written by `fold`, guarded by `foldMutex`
+        Setting<Type> writer;
+        const std::chrono::milliseconds flushInterval;
+
+        std::array<Shard, NUM_SHARDS> shards;
+
+        std::mutex readMutex;
+        std::mutex foldMutex;
+        std::atomic<std::thread::id> foldingThread{};
+
+        // Counts the phases of all folds so far, the phase of the current
+        // fold is `foldSequence % 4`:
+        // 0: no fold is running
+        // 1: the shards are being taken, readers wait
+        // 2: the setting is being updated, readers use `folded` instead
+        // 3: the counts of a failed fold are being put back, readers wait
+        std::atomic<std::uint64_t> foldSequence{0};
+        // What the setting is being updated to
+        std::atomic<Type> folded{};
+
+        // Set while a fold is scheduled on the timer wheel
+        std::atomic<bool> timerArmed{false};
+    };
+
+    static void
+    armTimer(const std::shared_ptr<State> &state)
+    {
+        if (state->flushInterval.count() <= 0 ||
+            state->timerArmed.load(std::memory_order_relaxed) ||
+            state->timerArmed.exchange(true, std::memory_order_acq_rel)) {
+            return;
+        }
+
+        std::weak_ptr<State> weakState = state;
+        detail::TimerWheel::instance().schedule(
+            state->flushInterval, [weakState] {
+                if (auto state = weakState.lock()) {
+                    state->timerArmed.store(false, std::memory_order_release);
+                    state->fold();
+                }
+            });
+    }
+
+    std::shared_ptr<State> state;
+
+    Signals::ScopedConnection saveConnection;
+};
+
+}  // namespace pajlada::Settings
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <rapidjson/document.h>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace pajlada::Settings {
+
+enum class LoadError {
+    NoError,
+    CannotOpenFile,
+    FileHandleError,
+    FileReadError,
+    FileSeekError,
+    JSONParseError,
+
+    /// The manager is frozen, see `SettingManager::freeze`
+    Frozen,
+
+    /// `SettingManager::reload` found the file empty, e.g. because another
+    /// writer has truncated it but not written it yet
+    FileEmpty,
+};
+
+/// Describes what a call to `Backend::persist` has to write
+struct PersistRequest {
+    /// If true, the whole document must be persisted
+    /// If false, only the values at `dirtyPaths` have changed since the last
+    /// successful persist to the same path
+    bool full = true;
+
+    /// JSON pointers of values that have been set or removed since the last
+    /// successful persist
+    std::vector<std::string> dirtyPaths;
+};
+
+/// @brief Storage used by a `SettingManager` to load and save its document
+///
+/// The default backend is a `JsonFileBackend`, which stores the document as a
+/// single (optionally sharded) JSON file with backups.
+class Backend
+{
+public:
+    virtual ~Backend() = default;
+
+    /// Load a snapshot of the settings stored at `path` into `document`
+    ///
+    /// `document` must be left untouched if nothing was stored at `path`
+    virtual LoadError load(const std::filesystem::path &path,
+                           rapidjson::Document &document) = 0;
+
+    /// Persist `document` to `path`
+    ///
+    /// Backends that can't write incrementally are free to ignore
+    /// `request.dirtyPaths` and always persist the full document.
+    ///
+    /// @returns true if the document was persisted successfully
+    virtual bool persist(const std::filesystem::path &path,
+                         const rapidjson::Document &document,
+                         const PersistRequest &request) = 0;
+
+    /// Block until everything persisted so far has reached its storage
+    ///
+    /// @returns true if all previous persists have completed successfully
+    virtual bool
+    flush()
+    {
+        return true;
+    }
+
+    /// Drop anything cached about the storage (e.g. resolved symlinks)
+    ///
+    /// Called when the settings path changes
+    virtual void
+    invalidate()
+    {
+    }
+};
+
+}  // namespace pajlada::Settings
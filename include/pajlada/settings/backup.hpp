@@ -1,16 +1,63 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
 #include <functional>
+#include <string>
 #include <system_error>
+#include <vector>
+
+namespace pajlada::Settings::detail {
+class RealPathCache;
+}  // namespace pajlada::Settings::detail
 
 namespace pajlada::Settings::Backup {
 
+enum class Rotation : std::uint8_t {
+    /// Every save shifts all backups up by one slot, so `.bkp-1` is always the
+    /// newest backup. Costs `numSlots` renames per save.
+    Shift,
+
+    /// Every save overwrites the oldest backup slot, going through the slots
+    /// in descending order. The slot holding the newest backup is stored in
+    /// `.bkp-index`. Costs a constant number of file operations per save.
+    ///
+    /// A set of `.bkp-N` files written with `Shift` is a valid starting point,
+    /// so switching to `Ring` needs no migration.
+    Ring,
+};
+
+enum class Durability : std::uint8_t {
+    /// Leave it to the operating system to write the file to disk. A crash
+    /// shortly after saving may lose the save, or (depending on the
+    /// filesystem) leave an empty file behind.
+    None,
+
+    /// Flush the contents of the new file to disk before it replaces the
+    /// current one, so the current file is always either the old or the new
+    /// save.
+    SyncFile,
+
+    /// Like `SyncFile`, and also flush the directory after the rename, so a
+    /// finished save survives a crash.
+    SyncFileAndDirectory,
+};
+
 struct Options {
     /// Whether the backup is done or not
     bool enabled = true;
     /// The number of backup files to use
     std::uint8_t numSlots = 3;
+    /// How backups are rotated between slots
+    Rotation rotation = Rotation::Shift;
+    /// If true, only the newest backup is a full copy. Every older backup is
+    /// stored as a delta against the next newer one, see `restoreBackup`.
+    bool deltas = false;
+    /// How hard to try to get a save onto the disk before returning
+    Durability durability = Durability::None;
+    /// If set, symlinks of the current file and the backup slots are resolved
+    /// through this cache. It must outlive any `DeferredRotation`.
+    detail::RealPathCache *realPathCache = nullptr;
 };
 
 /// @brief Orchestrates saving of a file (`path`) with optional backups
@@ -18,10 +65,14 @@ struct Options {
 /// The save operation works as follows:
 /// 1. The desired contents are written to a temporary file by `doWrite`
 /// 2. Past backups are shifted by one (`.bkp-1` -> `.bkp-2`; `.bkp-2` ->
-///    `.bkp-3` etc.)
+///    `.bkp-3` etc.). With `Rotation::Ring`, nothing is shifted.
 /// 3. The current file (`path` - not the temporary one) is moved to the backup
-///    (`.bkp-1`)
+///    (`.bkp-1`, or the oldest slot with `Rotation::Ring`)
 /// 4. The temporary file from step 1 is moved to the current file (`path`)
+///    (flushing the file and directory to disk as requested by
+///    `Options::durability`)
+/// 5. With `Options::deltas`, the previously newest backup is re-encoded as a
+///    delta against the new one
 ///
 /// The procedure is successful if and only if the value of `ec` is `0` after
 /// calling this function.
@@ -40,4 +91,47 @@ void saveWithBackup(const std::filesystem::path &path, Options options,
                                              std::error_code &ec)> &doWrite,
                     std::error_code &ec);
 
+/// A backup rotation left over by `saveWithDeferredBackup`
+using DeferredRotation = std::function<void(std::error_code &ec)>;
+
+/// @brief Like `saveWithBackup`, but leaves the backup rotation to the caller
+///
+/// Only the work needed for `path` to hold the new contents is done here: the
+/// temporary file is written and atomically swapped with the current file, so
+/// the previous contents end up in the temporary file. Moving them into the
+/// backup slots is returned as a `DeferredRotation`, which can e.g. be run on
+/// a background thread.
+///
+/// The rotation _must_ have finished before `path` is saved again, since it
+/// still needs the temporary file.
+///
+/// Swapping files is only supported on Linux. Everywhere else (or if the
+/// filesystem doesn't support it) the rotation is done right away and an
+/// empty function is returned, as it is when there is nothing to rotate.
+///
+/// @returns The rotation to run, or an empty function - the caller must check
+///          `ec` either way.
+DeferredRotation saveWithDeferredBackup(
+    const std::filesystem::path &path, Options options,
+    const std::function<void(const std::filesystem::path &,
+                             std::error_code &ec)> &doWrite,
+    std::error_code &ec);
+
+/// @brief Lists the existing backups of `path`, newest first
+///
+/// Works for backups written with either rotation scheme.
+std::vector<std::filesystem::path> listBackups(
+    const std::filesystem::path &path, Options options);
+
+/// @brief Reconstructs the contents of a backup of `path`
+///
+/// Works for full and delta-encoded backups.
+///
+/// @param age Which backup to restore: 1 is the newest backup, 2 the one
+///            before that etc. (i.e. the position in `listBackups`)
+/// @param ec Set if the backup doesn't exist or can't be decoded
+/// @returns The contents of the backup
+std::string restoreBackup(const std::filesystem::path &path, Options options,
+                          std::size_t age, std::error_code &ec);
+
 }  // namespace pajlada::Settings::Backup
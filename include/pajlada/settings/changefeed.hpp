@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <pajlada/settings/detail/mpscqueue.hpp>
+#include <string>
+#include <vector>
+
+namespace pajlada::Settings {
+
+class SettingManager;
+
+/// A change made to the document of a `SettingManager`
+struct Change {
+    enum class Kind : std::uint8_t {
+        /// A value was set
+        Set,
+        /// The value at `path` was removed
+        Removed,
+        /// The whole document was loaded or reloaded (`path` is "")
+        Loaded,
+    };
+
+    /// Increases by one with every change of the manager. Changes made
+    /// concurrently on different threads may be queued out of order.
+    std::uint64_t sequence = 0;
+
+    /// The JSON pointer that was changed
+    std::string path;
+
+    Kind kind = Kind::Set;
+};
+
+/// @brief Queues the changes of a `SettingManager` for an event loop
+///
+/// Setting a value only enqueues the change (lock-free). The loop waits for
+/// `fd()` to become readable and then takes all pending changes at once with
+/// `drain()`.
+///
+/// Get it with `SettingManager::changeFeed`. Only one thread may drain it.
+class ChangeFeed
+{
+public:
+    ~ChangeFeed();
+
+    ChangeFeed(const ChangeFeed &) = delete;
+    ChangeFeed &operator=(const ChangeFeed &) = delete;
+
+    /// An eventfd that is readable while changes are pending, for use with
+    /// poll/epoll. Don't read from it, `drain` resets it.
+    ///
+    /// Only supported on Linux, -1 everywhere else (`drain` still works).
+    int fd() const;
+
+    /// Take all pending changes in the order they were made, without blocking
+    ///
+    /// May return nothing, even if `fd()` was readable.
+    std::vector<Change> drain();
+
+private:
+    friend class SettingManager;
+
+    ChangeFeed();
+
+    // Called by the manager for every change
+    void push(Change change);
+
+    detail::MpscQueue<Change> queue;
+
+    // Set while the eventfd has been written to and not yet drained
+    std::atomic<bool> signalled{false};
+
+    int eventFd = -1;
+};
+
+}  // namespace pajlada::Settings
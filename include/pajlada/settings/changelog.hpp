@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <pajlada/settings/changefeed.hpp>
+#include <vector>
+
+namespace pajlada::Settings {
+
+/// The answer to "what has changed since sequence N"
+struct ChangesSince {
+    /// The changes were not all kept: re-read everything that's of interest,
+    /// and continue from `sequence`
+    bool resyncNeeded = false;
+
+    /// The changes after N, oldest first
+    std::vector<Change> changes;
+
+    /// The sequence number to ask for next time
+    std::uint64_t sequence = 0;
+};
+
+/// @brief Keeps the most recent changes of a `SettingManager` in a ring
+///
+/// See `SettingManager::changesSince`
+class ChangeLog
+{
+public:
+    explicit ChangeLog(std::size_t capacity);
+
+    /// Drops all recorded changes. Consumers that are behind `current` have
+    /// to resync.
+    void setCapacity(std::size_t capacity, std::uint64_t current);
+
+    void record(const Change &change);
+
+    /// @param current The latest sequence number handed out, returned if a
+    ///                resync is needed
+    ChangesSince since(std::uint64_t sequence, std::uint64_t current) const;
+
+private:
+    mutable std::mutex mutex;
+
+    // Change `n` is kept in slot `n % size`, as long as it's not overwritten
+    std::vector<Change> slots;
+
+    // Changes up to this one have been dropped by `setCapacity`
+    std::uint64_t floor = 0;
+};
+
+}  // namespace pajlada::Settings
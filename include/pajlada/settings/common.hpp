@@ -24,7 +24,9 @@ namespace Settings {
 enum class SettingOption : uint32_t {
     DoNotWriteToJSON = (1ULL << 1ULL),
 
-    /// A remote setting is a setting that is never saved locally, nor registered locally with any callbacks or anything
+    /// A remote setting is a setting that is never saved locally
+    /// Setting it sends the value to the process owning the document (see `RemoteClient`), which then echoes it back to all processes.
+    /// In the owning process (or without a `RemoteClient`), a remote setting behaves like a default setting.
     Remote = (1ULL << 2ULL),
 
     /// CompareBeforeSet compares the old & new value before updating the setting.
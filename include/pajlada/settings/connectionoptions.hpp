@@ -0,0 +1,51 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <pajlada/settings/executor.hpp>
+
+namespace pajlada::Settings {
+
+/// How often a connection is notified of a value that keeps changing. Values
+/// held back are dropped in favour of the newest one, which is always
+/// delivered eventually.
+enum class RateLimit : std::uint8_t {
+    /// Every change is delivered
+    None,
+
+    /// Deliver the newest value once it hasn't changed for `interval`
+    DebounceTrailing,
+
+    /// Deliver the first change right away, then like `DebounceTrailing` if it
+    /// kept changing
+    DebounceLeading,
+
+    /// Deliver at most one value per `interval`
+    Throttle,
+};
+
+struct ConnectionOptions {
+    /// Where the callback is run. If empty, it's run right away on the thread
+    /// that changed the value (or the one still delivering an earlier value).
+    ///
+    /// Notifications of a connection are queued and handed to the executor in
+    /// batches, one task per batch. They are delivered in the order the values
+    /// were set, and never concurrently, even on a multi-threaded executor.
+    Executor executor;
+
+    /// Only deliver the newest value of each batch, dropping the values it
+    /// has superseded
+    bool conflate = false;
+
+    /// Deliver the current value when connecting (through the executor). This
+    /// is not rate limited.
+    bool autoInvoke = true;
+
+    /// Rate limiting is driven by a timer thread shared by all connections.
+    /// Values delivered after a wait are delivered on that thread unless an
+    /// `executor` is set, so expensive callbacks should set one.
+    RateLimit rateLimit = RateLimit::None;
+    std::chrono::milliseconds interval{100};
+};
+
+}  // namespace pajlada::Settings
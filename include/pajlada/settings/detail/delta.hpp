@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace pajlada::Settings::detail {
+
+// Encode `target` as a line-based delta against `base`
+//
+// The delta consists of copies of line ranges from `base` and inserted
+// bytes, so its size scales with the size of the difference between the two
+// inputs.
+std::string makeDelta(std::string_view base, std::string_view target);
+
+// Returns true if `data` was produced by `makeDelta`
+bool isDelta(std::string_view data);
+
+// Reconstruct the `target` that `delta` was made from
+//
+// Returns false if `delta` is malformed or doesn't belong to `base`
+bool applyDelta(std::string_view base, std::string_view delta,
+                std::string &target);
+
+}  // namespace pajlada::Settings::detail
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace pajlada::Settings::detail {
+
+// Watches a single file for changes made by anyone, calling `onChanged` on a
+// background thread once the file has been quiet for `debounce` and its
+// contents differ from the last ones reported or ignored
+//
+// Only implemented on Linux (inotify). Elsewhere, the watcher never starts.
+class FileWatcher
+{
+public:
+    FileWatcher(std::filesystem::path path, std::chrono::milliseconds debounce,
+                std::function<void()> onChanged);
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher &) = delete;
+    FileWatcher &operator=(const FileWatcher &) = delete;
+
+    bool isRunning() const;
+
+    // Brackets a write of our own: changes are not reported while one is in
+    // progress, and if `written` the contents it left behind are ignored
+    void beginOwnWrite();
+    void endOwnWrite(bool written);
+
+private:
+    struct Fingerprint {
+        bool exists = false;
+        std::uint64_t size = 0;
+        std::size_t hash = 0;
+
+        bool operator==(const Fingerprint &other) const = default;
+    };
+
+    Fingerprint fingerprint() const;
+
+    void run();
+
+    std::filesystem::path path;
+    std::chrono::milliseconds debounce;
+    std::function<void()> onChanged;
+
+    std::mutex mutex;
+    // The contents of the file when it was last reported or ignored
+    Fingerprint known;
+    // The number of our own writes in progress
+    int ownWrites = 0;
+
+    int inotifyFd = -1;
+    // Written to by the destructor to wake up the thread
+    int stopFd = -1;
+
+    std::thread thread;
+};
+
+}  // namespace pajlada::Settings::detail
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace pajlada::Settings::detail {
+
+// Bumped whenever its SettingManager is frozen or thawed
+//
+// Shared with the settings of that manager: a value resolved while the
+// manager was frozen stays valid for as long as the epoch hasn't changed
+// since, which a reader can check without touching the manager.
+using FreezeEpoch = std::atomic<std::uint64_t>;
+
+}  // namespace pajlada::Settings::detail
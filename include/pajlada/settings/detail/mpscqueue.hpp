@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+namespace pajlada::Settings::detail {
+
+// Unbounded lock-free multi-producer single-consumer queue (Vyukov)
+//
+// `push` may be called from any thread, `pop` only from one thread at a time.
+// `pop` can return nothing while a concurrent `push` is halfway done, even if
+// items were pushed after it.
+template <typename T>
+class MpscQueue
+{
+public:
+    MpscQueue()
+        : head(new Node)
+        , tail(head.load())
+    {
+    }
+
+    ~MpscQueue()
+    {
+        while (this->pop()) {
+        }
+        delete this->tail;
+    }
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    void
+    push(T value)
+    {
+        auto *node = new Node;
+        node->value.emplace(std::move(value));
+
+        auto *prev = this->head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    std::optional<T>
+    pop()
+    {
+        auto *next = this->tail->next.load(std::memory_order_acquire);
+        if (next == nullptr) {
+            return std::nullopt;
+        }
+
+        // `next` becomes the new stub node
+        std::optional<T> value(std::move(next->value));
+        next->value.reset();
+
+        delete this->tail;
+        this->tail = next;
+
+        return value;
+    }
+
+private:
+    struct Node {
+        std::atomic<Node *> next{nullptr};
+        std::optional<T> value;
+    };
+
+    // Producers append here
+    std::atomic<Node *> head;
+    // Owned by the consumer, always a stub node whose value has been taken
+    Node *tail;
+};
+
+}  // namespace pajlada::Settings::detail
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <rapidjson/document.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace pajlada::Settings::detail {
+
+// Immutable JSON node of a persistent tree
+//
+// Nodes are never changed once built. A new version of a tree only rebuilds
+// the nodes along the changed path and shares everything else with the
+// previous version.
+struct PersistentNode {
+    using Ptr = std::shared_ptr<const PersistentNode>;
+
+    rapidjson::Type type = rapidjson::kNullType;
+
+    // Null, booleans and numbers
+    rapidjson::Value scalar;
+    std::string text;
+    // Unescaped member names, in document order
+    std::vector<std::pair<std::string, Ptr>> members;
+    std::vector<Ptr> elements;
+};
+
+// Converts `value` into a tree, O(size of `value`)
+PersistentNode::Ptr makePersistent(const rapidjson::Value &value);
+
+// Returns a version of `root` in which the value at `path` (and its parents)
+// match `document` again, after the value at `path` has been set or removed
+// in `document`
+PersistentNode::Ptr updatePersistent(const PersistentNode::Ptr &root,
+                                     const rapidjson::Value &document,
+                                     const std::string &path);
+
+// The node at `path`, or nullptr
+const PersistentNode *findPersistent(const PersistentNode::Ptr &root,
+                                     const std::string &path);
+
+// Copies the tree at `node` into `out`
+void copyPersistent(const PersistentNode &node, rapidjson::Value &out,
+                    rapidjson::Document::AllocatorType &allocator);
+
+}  // namespace pajlada::Settings::detail
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pajlada::Settings::detail {
+
+// Returns true if the JSON pointer `path` is `parent` or points to a value
+// inside of `parent`
+bool isSameOrChild(std::string_view path, std::string_view parent);
+
+// Orders JSON pointers by their tokens, so a pointer is directly followed by
+// the pointers inside of it (e.g. "/a", "/a/b", "/a-b")
+bool pointerLess(std::string_view a, std::string_view b);
+
+// Append `token` to the JSON pointer `path`, escaping '~' and '/'
+void appendPointerToken(std::string &path, std::string_view token);
+
+// Split the JSON pointer `path` into its tokens, which are left escaped
+std::vector<std::string> splitPointer(const std::string &path);
+
+// Unescape a JSON pointer token (~1 is '/', ~0 is '~')
+std::string unescapePointerToken(std::string_view token);
+
+}  // namespace pajlada::Settings::detail
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <rapidjson/document.h>
+
+#include <memory>
+#include <mutex>
+#include <pajlada/settings/signalargs.hpp>
+#include <pajlada/signals/signal.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pajlada::Settings::detail {
+
+// Trie of JSON pointer tokens, finding the subscribers of a changed path in
+// O(path depth)
+//
+// Nodes are kept once created, so the index grows with the number of
+// distinct prefixes that have been subscribed to.
+class PrefixIndex
+{
+public:
+    using PrefixSignal = Signals::Signal<const std::string &,
+                                         const rapidjson::Value &,
+                                         const SignalArgs &>;
+
+    // `prefix` may end in a slash, "/a/" is the same as "/a"
+    Signals::Connection connect(const std::string &prefix,
+                                PrefixSignal::CallbackType callback);
+
+    // Notify the subscribers of `path` and all its parents with `value`, and
+    // the subscribers below `path` with their part of `value` (or null)
+    void notify(const std::string &path, const rapidjson::Value &value,
+                const SignalArgs &args);
+
+private:
+    struct Node {
+        std::unordered_map<std::string, std::unique_ptr<Node>> children;
+        // Only set for subscribed prefixes
+        std::shared_ptr<PrefixSignal> signal;
+    };
+
+    struct Target {
+        std::shared_ptr<PrefixSignal> signal;
+        std::string path;
+        const rapidjson::Value *value;
+    };
+
+    // Collect the subscribed nodes below `node`, whose path is `path`
+    static void collectChildren(const Node &node, const std::string &path,
+                                const rapidjson::Value *value,
+                                std::vector<Target> &targets);
+
+    std::mutex mutex;
+    Node root;
+};
+
+}  // namespace pajlada::Settings::detail
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <pajlada/settings/connectionoptions.hpp>
+#include <pajlada/settings/detail/strand.hpp>
+#include <pajlada/settings/detail/timerwheel.hpp>
+#include <utility>
+
+namespace pajlada::Settings::detail {
+
+// Passes items on to a strand as limited by a `RateLimit`, keeping the last
+// item that was held back
+template <typename Item>
+class RateLimiter : public std::enable_shared_from_this<RateLimiter<Item>>
+{
+    using Clock = std::chrono::steady_clock;
+
+public:
+    static std::shared_ptr<RateLimiter>
+    create(std::shared_ptr<Strand<Item>> strand, RateLimit mode,
+           std::chrono::milliseconds interval)
+    {
+        return std::shared_ptr<RateLimiter>(
+            new RateLimiter(std::move(strand), mode, interval));
+    }
+
+    void
+    push(Item item)
+    {
+        bool needsSchedule = false;
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+
+            auto now = Clock::now();
+
+            if (this->mode == RateLimit::Throttle) {
+                if (!this->armed &&
+                    now - this->lastDelivery >= this->interval) {
+                    this->lastDelivery = now;
+                    needsSchedule = this->strand->enqueue(std::move(item));
+                } else {
+                    this->latest = std::move(item);
+                    if (!this->armed) {
+                        this->arm(this->lastDelivery + this->interval - now);
+                    }
+                }
+            } else {
+                this->deadline = now + this->interval;
+
+                if (this->mode == RateLimit::DebounceLeading &&
+                    !this->armed) {
+                    // Quiet until now, deliver right away
+                    needsSchedule = this->strand->enqueue(std::move(item));
+                } else {
+                    this->latest = std::move(item);
+                }
+
+                if (!this->armed) {
+                    this->arm(this->interval);
+                }
+            }
+        }
+
+        if (needsSchedule) {
+            this->strand->schedule();
+        }
+    }
+
+private:
+    RateLimiter(std::shared_ptr<Strand<Item>> _strand, RateLimit _mode,
+                std::chrono::milliseconds _interval)
+        : strand(std::move(_strand))
+        , mode(_mode)
+        , interval(_interval)
+    {
+    }
+
+    // Must be called with the mutex held
+    void
+    arm(Clock::duration delay)
+    {
+        this->armed = true;
+
+        std::weak_ptr<RateLimiter> weak = this->shared_from_this();
+        TimerWheel::instance().schedule(
+            std::chrono::ceil<std::chrono::milliseconds>(delay), [weak] {
+                if (auto self = weak.lock()) {
+                    self->onTimer();
+                }
+            });
+    }
+
+    void
+    onTimer()
+    {
+        bool needsSchedule = false;
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+
+            auto now = Clock::now();
+
+            if (this->mode != RateLimit::Throttle && now < this->deadline) {
+                // Still changing, wait for it to settle
+                this->arm(this->deadline - now);
+                return;
+            }
+
+            this->armed = false;
+
+            if (this->latest) {
+                this->lastDelivery = now;
+                needsSchedule = this->strand->enqueue(std::move(*this->latest));
+                this->latest.reset();
+            }
+        }
+
+        if (needsSchedule) {
+            this->strand->schedule();
+        }
+    }
+
+    const std::shared_ptr<Strand<Item>> strand;
+    const RateLimit mode;
+    const std::chrono::milliseconds interval;
+
+    std::mutex mutex;
+    std::optional<Item> latest;
+    // Whether a timer is scheduled
+    bool armed = false;
+    // Debounce: when the value will have been quiet for long enough
+    Clock::time_point deadline;
+    // Throttle: when an item was last passed on
+    Clock::time_point lastDelivery;
+};
+
+}  // namespace pajlada::Settings::detail
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <filesystem>
+#include <mutex>
+#include <unordered_map>
 
 namespace pajlada {
 namespace Settings {
@@ -9,6 +11,28 @@ namespace detail {
 std::filesystem::path RealPath(const std::filesystem::path &_path,
                                std::error_code &ec);
 
+// Remembers the results of `RealPath`, so resolving the same path again costs
+// no syscalls
+//
+// Paths are assumed to keep pointing to the same place until `clear` is
+// called. Renaming a file over a resolved path doesn't change where it points
+// to, so this holds for everything done by `Backup::saveWithBackup`.
+class RealPathCache
+{
+public:
+    std::filesystem::path resolve(const std::filesystem::path &path,
+                                  std::error_code &ec);
+
+    void clear();
+
+private:
+    std::mutex mutex;
+
+    std::unordered_map<std::filesystem::path::string_type,
+                       std::filesystem::path>
+        resolvedPaths;
+};
+
 }  // namespace detail
 }  // namespace Settings
 }  // namespace pajlada
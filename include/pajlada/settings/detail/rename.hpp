@@ -7,4 +7,12 @@ namespace pajlada::Settings::detail {
 void renameFile(const std::filesystem::path &from,
                 const std::filesystem::path &to, std::error_code &ec);
 
+// Atomically swap the files at `a` and `b`
+//
+// Only supported on Linux (`renameat2` with `RENAME_EXCHANGE`). Returns false
+// if the swap was not done, in which case `ec` tells why (e.g.
+// `std::errc::operation_not_supported`)
+bool exchangeFiles(const std::filesystem::path &a,
+                   const std::filesystem::path &b, std::error_code &ec);
+
 }  // namespace pajlada::Settings::detail
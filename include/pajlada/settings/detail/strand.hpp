@@ -0,0 +1,174 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <pajlada/settings/detail/mpscqueue.hpp>
+#include <pajlada/settings/executor.hpp>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace pajlada::Settings::detail {
+
+// Delivers items pushed from any thread through an executor, in push order
+// and one batch at a time
+//
+// At most one drain task is posted or running at any time: `pending` counts
+// the items not yet delivered, and only the push taking it from 0 posts a
+// task. The task re-posts itself if more items came in while it was running,
+// or keeps draining inline if there is no executor.
+template <typename Item>
+class Strand : public std::enable_shared_from_this<Strand<Item>>
+{
+public:
+    using Deliver = std::function<void(Item &)>;
+
+    static std::shared_ptr<Strand>
+    create(Executor executor, bool conflate, Deliver deliver)
+    {
+        return std::shared_ptr<Strand>(
+            new Strand(std::move(executor), conflate, std::move(deliver)));
+    }
+
+    void
+    push(Item item)
+    {
+        if (this->enqueue(std::move(item))) {
+            this->schedule();
+        }
+    }
+
+    // Split up `push`, so callers can fix the order of items under their own
+    // lock and run (or post) the delivery after releasing it
+    // Returns true if `schedule` must be called
+    bool
+    enqueue(Item item)
+    {
+        this->queue.push(std::move(item));
+
+        return this->pending.fetch_add(1, std::memory_order_acq_rel) == 0;
+    }
+
+    void
+    schedule()
+    {
+        this->post();
+    }
+
+    // Stop delivering. A batch being delivered right now is not waited for.
+    void
+    cancel()
+    {
+        this->cancelled.store(true, std::memory_order_release);
+    }
+
+    // Cancels the strand when the last copy of it is destroyed, so it can be
+    // tied to the lifetime of a signal connection
+    struct Guard {
+        explicit Guard(std::shared_ptr<Strand> _strand)
+            : strand(std::move(_strand))
+        {
+        }
+
+        ~Guard()
+        {
+            this->strand->cancel();
+        }
+
+        Guard(const Guard &) = delete;
+        Guard &operator=(const Guard &) = delete;
+
+        std::shared_ptr<Strand> strand;
+    };
+
+private:
+    Strand(Executor _executor, bool _conflate, Deliver _deliver)
+        : executor(std::move(_executor))
+        , conflate(_conflate)
+        , deliver(std::move(_deliver))
+    {
+    }
+
+    void
+    post()
+    {
+        auto self = this->shared_from_this();
+
+        if (!this->executor) {
+            self->drain();
+            return;
+        }
+
+        this->executor([self] {
+            self->drain();
+        });
+    }
+
+    void
+    drain()
+    {
+        auto count = this->pending.load(std::memory_order_acquire);
+
+        while (true) {
+            this->deliverBatch(count);
+
+            auto left =
+                this->pending.fetch_sub(count, std::memory_order_acq_rel) -
+                count;
+            if (left == 0) {
+                return;
+            }
+
+            if (this->executor) {
+                // Give other tasks of the executor a turn
+                this->post();
+                return;
+            }
+
+            // Delivered inline: loop instead of recursing through `post`, so
+            // a steady stream of pushes can't grow the stack
+            count = left;
+        }
+    }
+
+    void
+    deliverBatch(std::size_t count)
+    {
+        std::vector<Item> batch;
+        batch.reserve(count);
+        while (batch.size() < count) {
+            auto item = this->queue.pop();
+            if (!item) {
+                // Counted items are fully pushed, but an earlier push may
+                // still be linking its node
+                std::this_thread::yield();
+                continue;
+            }
+            batch.push_back(std::move(*item));
+        }
+
+        if (this->cancelled.load(std::memory_order_acquire)) {
+            return;
+        }
+
+        if (this->conflate) {
+            this->deliver(batch.back());
+        } else {
+            for (auto &item : batch) {
+                this->deliver(item);
+            }
+        }
+    }
+
+    const Executor executor;
+    const bool conflate;
+    const Deliver deliver;
+
+    MpscQueue<Item> queue;
+    std::atomic<std::size_t> pending{0};
+    std::atomic<bool> cancelled{false};
+};
+
+}  // namespace pajlada::Settings::detail
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <filesystem>
+
+namespace pajlada::Settings::detail {
+
+// Flush the contents of the file at `path` to its storage device
+void syncFile(const std::filesystem::path &path, std::error_code &ec);
+
+// Flush the directory entries of `directory` (e.g. after a rename inside of
+// it) to its storage device
+//
+// This is a no-op on Windows, where renames done by `renameFile` are already
+// written through
+void syncDirectory(const std::filesystem::path &directory,
+                   std::error_code &ec);
+
+}  // namespace pajlada::Settings::detail
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pajlada::Settings::detail {
+
+// Hashed timer wheel running one-shot callbacks on a single thread
+//
+// Timers are rounded up to the next tick and can't be cancelled; callbacks
+// should hold weak references to whatever they fire for. The thread sleeps
+// while no timers are scheduled.
+class TimerWheel
+{
+public:
+    using Callback = std::function<void()>;
+
+    explicit TimerWheel(
+        std::chrono::milliseconds tick = std::chrono::milliseconds(5),
+        std::size_t numSlots = 512);
+    ~TimerWheel();
+
+    TimerWheel(const TimerWheel &) = delete;
+    TimerWheel &operator=(const TimerWheel &) = delete;
+
+    // The wheel shared by all rate-limited connections
+    static TimerWheel &instance();
+
+    void schedule(std::chrono::milliseconds delay, Callback callback);
+
+private:
+    struct Entry {
+        // Full turns of the wheel left before it fires
+        std::uint64_t rounds;
+        Callback callback;
+    };
+
+    void run();
+
+    const std::chrono::milliseconds tick;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<std::vector<Entry>> slots;
+    std::size_t current = 0;
+    std::size_t numEntries = 0;
+    bool stopping = false;
+
+    std::thread thread;
+};
+
+}  // namespace pajlada::Settings::detail
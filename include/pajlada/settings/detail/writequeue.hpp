@@ -0,0 +1,74 @@
+#pragma once
+
+#include <rapidjson/document.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <pajlada/settings/detail/mpscqueue.hpp>
+#include <pajlada/settings/signalargs.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pajlada::Settings::detail {
+
+// Queue of writes applied in order by a single thread
+//
+// Any thread can push; pushing never locks unless the apply thread is
+// asleep. The apply thread takes up to `MAX_BATCH` writes at a time and
+// hands them to `ApplyBatch` together.
+class WriteQueue
+{
+public:
+    struct Write {
+        std::string path;
+        rapidjson::Document value;
+        SignalArgs args;
+    };
+
+    using ApplyBatch = std::function<void(std::vector<Write> &)>;
+
+    static constexpr std::size_t MAX_BATCH = 1024;
+
+    explicit WriteQueue(ApplyBatch apply);
+
+    // Applies the writes that are still queued before returning
+    ~WriteQueue();
+
+    WriteQueue(const WriteQueue &) = delete;
+    WriteQueue &operator=(const WriteQueue &) = delete;
+
+    void push(Write write);
+
+    // Waits until all writes pushed by this thread have been applied
+    // Returns right away if called from the apply thread
+    void flush();
+
+private:
+    struct Item {
+        Write write;
+        // Set for the barriers pushed by `flush`
+        std::promise<void> *barrier = nullptr;
+    };
+
+    void enqueue(Item item);
+
+    void run();
+
+    const ApplyBatch apply;
+
+    MpscQueue<Item> queue;
+    std::atomic<std::size_t> pending{0};
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+
+    std::thread thread;
+};
+
+}  // namespace pajlada::Settings::detail
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pajlada::Settings {
+
+/// Runs a task somewhere else, e.g. on a thread pool or an event loop
+using Executor = std::function<void(std::function<void()> task)>;
+
+/// @brief A fixed-size pool of threads running posted tasks
+///
+/// Tasks that have been posted before the pool is destroyed are still run.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(
+        std::size_t numThreads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    void post(std::function<void()> task);
+
+    /// An executor posting to this pool. Must not outlive the pool.
+    Executor executor();
+
+private:
+    void run();
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<std::function<void()>> tasks;
+    bool stopping = false;
+
+    std::vector<std::thread> threads;
+};
+
+}  // namespace pajlada::Settings
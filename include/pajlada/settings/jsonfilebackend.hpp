@@ -0,0 +1,86 @@
+#pragma once
+
+#include <future>
+#include <mutex>
+#include <pajlada/settings/backend.hpp>
+#include <pajlada/settings/backup.hpp>
+#include <pajlada/settings/detail/realpath.hpp>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace pajlada::Settings {
+
+/// @brief Stores the document as a pretty-printed JSON file with backups
+///
+/// Subtrees of the document can be moved into their own files with
+/// `addShard`. Each shard has its own backup rotation and is only rewritten if
+/// one of the dirty paths of a persist request lies inside of it. Likewise,
+/// the main file is only rewritten if one of them lies outside of all
+/// shards.
+class JsonFileBackend : public Backend
+{
+public:
+    LoadError load(const std::filesystem::path &path,
+                   rapidjson::Document &document) override;
+
+    bool persist(const std::filesystem::path &path,
+                 const rapidjson::Document &document,
+                 const PersistRequest &request) override;
+
+    /// Waits for a deferred backup rotation to finish
+    ///
+    /// @returns false if a deferred rotation failed since the last flush
+    bool flush() override;
+
+    void invalidate() override;
+
+    void setBackupEnabled(bool enabled = true);
+    void setBackupSlots(uint8_t numSlots);
+    void setBackupRotation(Backup::Rotation rotation);
+    void setBackupDeltasEnabled(bool enabled = true);
+    void setDurability(Backup::Durability durability);
+
+    /// Rotate backups on a background thread after the new files are in
+    /// place. Only has an effect where `Backup::saveWithDeferredBackup`
+    /// supports it.
+    void setBackupDeferred(bool deferred = true);
+
+    /// Store the subtree at `pointer` (e.g. "/highlights") in its own file
+    ///
+    /// A relative `path` is resolved against the directory of the main
+    /// settings file. Shards must not overlap each other.
+    void addShard(const std::string &pointer,
+                  const std::filesystem::path &path);
+
+private:
+    struct Shard {
+        /// JSON pointer of the subtree stored in this shard
+        std::string pointer;
+        std::filesystem::path path;
+    };
+
+    /// Must be called with `mutex` held
+    /// Returns the first error of the deferred rotations since the last
+    /// `flush`
+    std::error_code waitForRotation();
+
+    std::mutex mutex;
+
+    Backup::Options backup;
+
+    bool deferRotation = false;
+
+    /// Resolved paths of the files we save to. Refreshed on every load.
+    detail::RealPathCache realPaths;
+
+    /// The backup rotations left over by the last persist, resolving to the
+    /// first error
+    std::future<std::error_code> pendingRotation;
+    /// The first error of a deferred rotation, kept until `flush` reports it
+    std::error_code rotationError;
+
+    std::vector<Shard> shards;
+};
+
+}  // namespace pajlada::Settings
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <map>
+#include <mutex>
+#include <pajlada/settings/backend.hpp>
+#include <pajlada/settings/backup.hpp>
+#include <string>
+
+namespace pajlada::Settings {
+
+/// @brief Stores the document as an append-only log of path/value records
+///
+/// Every persist appends one record per dirty path (or a tombstone if the
+/// value was removed), so the cost of a save scales with the number of
+/// changed settings instead of the size of the document. A full persist
+/// rewrites the log with one record per top-level member.
+///
+/// An in-memory index keeps track of which records are still live. Once the
+/// log is larger than the compaction threshold and more than half of it is
+/// garbage, live records are copied into a fresh log on a background thread.
+/// Saves go on while the live records are copied, the records they append in
+/// the meantime are carried over right before the fresh log replaces the old
+/// one.
+///
+/// On load, the log is replayed in order. A truncated or corrupt record at the
+/// end of the log (e.g. from a crash mid-write) is cut off, and everything up
+/// to it is kept.
+class LogBackend : public Backend
+{
+public:
+    ~LogBackend() override;
+
+    LoadError load(const std::filesystem::path &path,
+                   rapidjson::Document &document) override;
+
+    bool persist(const std::filesystem::path &path,
+                 const rapidjson::Document &document,
+                 const PersistRequest &request) override;
+
+    bool flush() override;
+
+    /// Set the minimum size in bytes of the log before compaction is
+    /// considered
+    void setCompactionThreshold(std::uint64_t numBytes);
+
+    /// Set how hard rewrites, compactions and appended records try to get
+    /// onto the disk. Appended records are only synced with
+    /// `SyncFileAndDirectory`, a crash otherwise loses at most the last
+    /// records, see above.
+    void setDurability(Backup::Durability durability);
+
+private:
+    struct Entry {
+        std::uint64_t offset;
+        std::uint32_t size;
+    };
+
+    // Add the record at `offset` to the index, dropping any record it
+    // shadows
+    void indexRecord(const std::string &path, Entry entry);
+
+    bool rewrite(const std::filesystem::path &path,
+                 const rapidjson::Document &document);
+    bool compact();
+    void compactIfNeeded();
+
+    std::mutex mutex;
+
+    /// The log the index belongs to
+    std::filesystem::path logPath;
+    /// Changed whenever the log is replaced by a load or rewrite, which makes
+    /// a compaction that's running throw its result away
+    std::uint64_t logGeneration = 0;
+
+    //       path         record
+    std::map<std::string, Entry> index;
+
+    std::uint64_t logSize = 0;
+    std::uint64_t liveSize = 0;
+
+    std::uint64_t compactionThreshold = 64 * 1024;
+
+    Backup::Durability durability = Backup::Durability::None;
+
+    std::future<bool> compaction;
+};
+
+}  // namespace pajlada::Settings
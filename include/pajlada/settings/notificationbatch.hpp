@@ -0,0 +1,30 @@
+#pragma once
+
+#include <functional>
+
+namespace pajlada::Settings {
+
+/// @brief Groups the notifications sent on this thread while it's alive
+///
+/// Anything that reacts to a batch of changes (e.g. a coalescing
+/// `SettingListener`) can defer its work until the outermost batch of the
+/// current thread ends. Batches nest, and loading or reloading a file always
+/// runs in one.
+class NotificationBatch
+{
+public:
+    NotificationBatch();
+    ~NotificationBatch();
+
+    NotificationBatch(const NotificationBatch &) = delete;
+    NotificationBatch &operator=(const NotificationBatch &) = delete;
+
+    /// Whether a batch is open on this thread
+    static bool active();
+
+    /// Runs `callback` once the outermost batch of this thread has ended, or
+    /// right away if there's no batch
+    static void defer(std::function<void()> callback);
+};
+
+}  // namespace pajlada::Settings
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <pajlada/signals/signal.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pajlada::Settings {
+
+class SettingManager;
+
+namespace detail {
+
+/// A value set at `path`, serialized as compact JSON
+struct RemoteDelta {
+    std::string path;
+    std::string json;
+};
+
+/// Deltas waiting to be sent
+///
+/// A delta replaces any pending delta at the same path or below it, so a
+/// burst of changes to the same setting is sent as a single value.
+class RemoteDeltaQueue
+{
+public:
+    void push(std::string path, std::string json);
+    std::vector<RemoteDelta> take();
+
+private:
+    std::mutex mutex;
+    std::vector<RemoteDelta> deltas;
+};
+
+}  // namespace detail
+
+/// @brief Shares the document of the owning `SettingManager` with
+/// `RemoteClient`s in other processes over a Unix domain socket
+///
+/// Clients receive the full document when they connect, and after that only
+/// the paths & values that were set, in the order they were applied to the
+/// document. Changes are batched: everything that is set while the server is
+/// busy sending is sent as one frame. Values sent by clients are set in the
+/// owner (with `SignalArgs::Source::External`) and echoed back to all
+/// clients.
+///
+/// The server never waits for a client. What a client hasn't read yet is
+/// buffered, and a client that falls too far behind is disconnected.
+///
+/// Values set with `SettingOption::DoNotWriteToJSON` are not shared.
+///
+/// Incoming values are set on the server's thread. Not supported on Windows.
+class RemoteServer
+{
+public:
+    RemoteServer(std::shared_ptr<SettingManager> owner,
+                 std::filesystem::path socketPath);
+    ~RemoteServer();
+
+    RemoteServer(const RemoteServer &) = delete;
+    RemoteServer &operator=(const RemoteServer &) = delete;
+
+    bool isRunning() const;
+
+private:
+    void run();
+    void wake();
+
+    std::shared_ptr<SettingManager> owner;
+    std::filesystem::path socketPath;
+
+    detail::RemoteDeltaQueue pending;
+
+    int listenFd = -1;
+    // Written to whenever `pending` has something to send or we're stopping
+    int wakeFds[2] = {-1, -1};
+    std::atomic<bool> stopping = false;
+
+    std::thread thread;
+};
+
+/// @brief Mirrors the document of a `RemoteServer` into `mirror`
+///
+/// `Setting`s of `mirror` work as usual, their callbacks are invoked on the
+/// client's thread. Values of `SettingOption::Remote` settings are sent to
+/// the server instead of being set locally.
+///
+/// The mirror is never saved, its save method is set to `SaveManually`.
+///
+/// Not supported on Windows.
+class RemoteClient
+{
+public:
+    RemoteClient(std::shared_ptr<SettingManager> mirror,
+                 std::filesystem::path socketPath);
+    ~RemoteClient();
+
+    RemoteClient(const RemoteClient &) = delete;
+    RemoteClient &operator=(const RemoteClient &) = delete;
+
+    /// false if the connection couldn't be made or was closed by the server
+    bool isConnected() const;
+
+private:
+    void run();
+    void wake();
+
+    std::shared_ptr<SettingManager> mirror;
+
+    detail::RemoteDeltaQueue pending;
+
+    int fd = -1;
+    int wakeFds[2] = {-1, -1};
+    std::atomic<bool> stopping = false;
+    std::atomic<bool> connected = false;
+
+    std::thread thread;
+};
+
+}  // namespace pajlada::Settings
@@ -2,9 +2,19 @@
 
 #include <rapidjson/document.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
 #include <iostream>
 #include <mutex>
+#include <optional>
 #include <pajlada/settings/common.hpp>
+#include <pajlada/settings/connectionoptions.hpp>
+#include <pajlada/settings/detail/freezeepoch.hpp>
+#include <pajlada/settings/detail/ratelimiter.hpp>
+#include <pajlada/settings/detail/strand.hpp>
 #include <pajlada/settings/equal.hpp>
 #include <pajlada/settings/settingdata.hpp>
 #include <pajlada/settings/settingmanager.hpp>
@@ -13,6 +23,8 @@
 
 namespace pajlada::Settings {
 
+class Transaction;
+
 namespace detail {
 
 inline SignalArgs
@@ -148,8 +160,51 @@ public:
     const Type &
     getValue() const
     {
+        // The value resolved while our manager was frozen can't change until
+        // it's frozen or thawed again
+        const auto *managerEpoch =
+            this->freezeEpoch.load(std::memory_order_acquire);
+        if (managerEpoch != nullptr &&
+            this->frozenEpoch.load(std::memory_order_acquire) ==
+                managerEpoch->load(std::memory_order_acquire)) {
+            return *this->frozenValue.load(std::memory_order_relaxed);
+        }
+
         std::unique_lock<std::mutex> lock(this->valueMutex);
 
+        auto lockedSetting = this->data.lock();
+        if (!lockedSetting) {
+            return this->resolveValue();
+        }
+
+        if (!this->freezeEpochOwner) {
+            this->freezeEpochOwner = lockedSetting->getFreezeEpoch();
+            this->freezeEpoch.store(this->freezeEpochOwner.get(),
+                                    std::memory_order_release);
+        }
+
+        // Read before checking whether the manager is frozen, so a thaw in
+        // between is caught by the next getValue
+        auto epoch = this->freezeEpochOwner->load(std::memory_order_acquire);
+        if (this->frozenEpoch.load(std::memory_order_relaxed) == epoch) {
+            return *this->frozenValue.load(std::memory_order_relaxed);
+        }
+
+        const auto &resolved = this->resolveValue();
+
+        if (lockedSetting->isFrozen()) {
+            this->frozenValue.store(&resolved, std::memory_order_relaxed);
+            this->frozenEpoch.store(epoch, std::memory_order_release);
+        }
+
+        return resolved;
+    }
+
+private:
+    // Must be called with valueMutex held
+    const Type &
+    resolveValue() const
+    {
         auto lockedSetting = this->data.lock();
 
         if (!lockedSetting) {
@@ -171,9 +226,18 @@ public:
         }
         this->updateIteration = currentUpdateIteration;
 
-        auto p = lockedSetting->template unmarshal<Type>();
-        if (p) {
-            this->value = std::forward<decltype(p)>(p);
+        // Deserialized once for the connections notified in this update
+        // iteration, copied into our own storage so references returned by
+        // getValue stay valid across updates
+        if (auto notified = lockedSetting->template findDeserialized<Type>(
+                currentUpdateIteration)) {
+            this->value = *notified;
+        } else {
+            // Copied, the document may be written while we deserialize
+            rapidjson::Document json;
+            if (lockedSetting->copyValue(json)) {
+                this->value = Deserialize<Type>::get(json);
+            }
         }
 
         if (this->value) {
@@ -183,6 +247,22 @@ public:
         return this->defaultValue;
     }
 
+public:
+    // Resolve the value from a view of a document other than the one of our
+    // SettingManager (e.g. a Snapshot or a SharedSnapshotReader)
+    // The view must have a `template <typename T> std::optional<T> get(path)`
+    template <typename View>
+    Type
+    getValue(const View &view) const
+    {
+        auto v = view.template get<Type>(this->path);
+        if (v) {
+            return std::move(*v);
+        }
+
+        return this->defaultValue;
+    }
+
     template <typename T = Type,
               typename = std::enable_if_t<is_stl_container<T>::value>>
     const Type &
@@ -210,22 +290,67 @@ public:
         return p.first;
     }
 
+    /// Set the value to `desired` if it's currently equal to `expected`
+    ///
+    /// The value is compared with, and replaced in, the document of the
+    /// manager without any other write in between. If the value differs,
+    /// `expected` is set to the current value.
+    ///
+    /// For `SettingOption::Remote` settings only the local check is atomic.
+    ///
+    /// @returns true if the value was set
+    bool
+    compareExchange(Type &expected, const Type &desired,
+                    SignalArgs &&args = SignalArgs())
+    {
+        auto next = this->tryUpdate(
+            [&](const Type &current) -> std::optional<Type> {
+                if (!IsEqual<Type>::get(current, expected)) {
+                    expected = current;
+                    return std::nullopt;
+                }
+
+                return desired;
+            },
+            std::move(args));
+
+        return next.has_value();
+    }
+
+    /// Replace the value with `fn(currentValue)`, without losing writes made
+    /// by other threads in the meantime
+    ///
+    /// `fn` runs without holding any lock, and runs again with the new value
+    /// if the value changed before the result could be set. It should not have
+    /// side effects.
+    ///
+    /// @returns the value that was set, or nothing if the setting couldn't be
+    ///          written (e.g. the manager is frozen)
+    template <typename Fn>
+    std::optional<Type>
+    update(Fn &&fn, SignalArgs &&args = SignalArgs())
+    {
+        return this->tryUpdate(
+            [&](const Type &current) -> std::optional<Type> {
+                return fn(current);
+            },
+            std::move(args));
+    }
+
     // Implement vector helper stuff
     template <typename T = Type,
               typename = std::enable_if_t<is_stl_container<T>::value>>
     void
     push_back(typename T::value_type newItem, SignalArgs &&args = SignalArgs())
     {
-        // TODO(pajlada): refresh this->value first?
-        this->valueMutex.lock();
-        if (!this->value) {
-            this->value = Type{};
-        }
-
-        (*this->value).push_back(std::move(newItem));
-        auto copy = *this->value;
-        this->valueMutex.unlock();
-        this->updateValue(copy, std::move(args));
+        this->tryUpdate(
+            [&](const Type &current) -> std::optional<Type> {
+                Type copy = current;
+                copy.push_back(newItem);
+
+                return copy;
+            },
+            std::move(args));
     }
 
     template <typename T = Type,
@@ -234,37 +359,107 @@ public:
     removeByValue(const typename T::value_type &key,
                   SignalArgs &&args = SignalArgs())
     {
-        // TODO(pajlada): refresh this->value first?
+        this->tryUpdate(
+            [&](const Type &current) -> std::optional<Type> {
+                Type copy = current;
+                copy.erase(std::remove(copy.begin(), copy.end(), key),
+                           copy.end());
+
+                if (copy.size() == current.size()) {
+                    // nothing was removed
+                    return std::nullopt;
+                }
+
+                return copy;
+            },
+            std::move(args));
+    }
 
-        T copy;
+private:
+    // Read-modify-write of the value, retried until the value `step` saw is
+    // still the current one when its result is written
+    // `step` returns the new value, or nothing to leave the value as it is
+    template <typename Step>
+    std::optional<Type>
+    tryUpdate(Step &&step, SignalArgs &&args)
+    {
+        auto lockedSetting = this->data.lock();
+        if (!lockedSetting) {
+            return std::nullopt;
+        }
 
-        {
-            std::unique_lock<std::mutex> lock(this->valueMutex);
-            if (!this->value) {
-                return;
+        if (args.source == SignalArgs::Source::Unset) {
+            args.source = SignalArgs::Source::Setter;
+        }
+
+        if (this->optionEnabled(SettingOption::DoNotWriteToJSON)) {
+            // The value only lives in this setting
+            std::optional<Type> next;
+            {
+                std::unique_lock<std::mutex> lock(this->valueMutex);
+                if (lockedSetting->isFrozen()) {
+                    return std::nullopt;
+                }
+
+                next = step(this->value ? *this->value : this->defaultValue);
+                if (!next) {
+                    return std::nullopt;
+                }
+
+                this->value = *next;
             }
 
-            copy = (*this->value);
+            this->updateValue(*next, std::move(args));
+            return next;
         }
 
-        auto valueSize = copy.size();
-
-        copy.erase(std::remove(copy.begin(), copy.end(), key), copy.end());
+        if (this->optionEnabled(SettingOption::Remote)) {
+            auto next = step(this->getValue());
+            if (next && !this->setValue(*next, std::move(args))) {
+                return std::nullopt;
+            }
 
-        if (copy.size() == valueSize) {
-            // nothing was removed
-            return;
+            return next;
         }
 
-        {
-            this->valueMutex.lock();
-            this->value = copy;
-            this->valueMutex.unlock();
-            this->updateValue(copy, std::move(args));
+        while (!lockedSetting->isFrozen()) {
+            rapidjson::Document json;
+            bool exists = lockedSetting->getCopy(json);
+
+            auto next = exists ? step(Deserialize<Type>::get(json))
+                               : step(this->defaultValue);
+            if (!next) {
+                return std::nullopt;
+            }
+
+            if (!lockedSetting->compareAndSet(exists ? &json : nullptr, *next,
+                                              SignalArgs(args))) {
+                // Changed in the meantime
+                continue;
+            }
+
+            {
+                std::unique_lock<std::mutex> lock(this->valueMutex);
+                if (!lockedSetting->isFrozen()) {
+                    this->value = *next;
+                }
+            }
+
+            return next;
         }
+
+        return std::nullopt;
     }
 
 private:
+    bool
+    managerFrozen() const
+    {
+        auto lockedSetting = this->data.lock();
+
+        return lockedSetting && lockedSetting->isFrozen();
+    }
+
     bool
     updateValue(const Type &newValue, SignalArgs &&args)
     {
@@ -272,6 +467,10 @@ private:
             args.writeToFile = false;
         }
 
+        if (this->optionEnabled(SettingOption::Remote)) {
+            args.remote = true;
+        }
+
         auto lockedSetting = this->data.lock();
 
         if (lockedSetting) {
@@ -294,6 +493,10 @@ public:
 
         {
             std::unique_lock<std::mutex> lock(this->valueMutex);
+            if (this->managerFrozen()) {
+                // Values resolved while frozen point into `value`
+                return false;
+            }
             this->value = newValue;
         }
 
@@ -301,6 +504,10 @@ public:
             args.writeToFile = false;
         }
 
+        if (this->optionEnabled(SettingOption::Remote)) {
+            args.remote = true;
+        }
+
         auto lockedSetting = this->data.lock();
 
         if (lockedSetting) {
@@ -404,6 +611,21 @@ public:
     }
 
 private:
+    friend class Transaction;
+
+    // Where a committed transaction puts the value of a DoNotWriteToJSON
+    // setting
+    void
+    storeLocally(const Type &newValue) const
+    {
+        std::unique_lock<std::mutex> lock(this->valueMutex);
+        if (this->managerFrozen()) {
+            // Values resolved while frozen point into `value`
+            return;
+        }
+        this->value = newValue;
+    }
+
     std::weak_ptr<SettingData> data;
     SettingOption options = SettingOption::Default;
     Type defaultValue{};
@@ -413,6 +635,16 @@ private:
     mutable std::optional<Type> value;
     mutable int updateIteration = -1;
 
+    // Set by getValue while our manager is frozen, see
+    // SettingManager::freeze
+    // `frozenValue` points at `*value` or `defaultValue`
+    mutable std::atomic<std::uint64_t> frozenEpoch{0};
+    mutable std::atomic<const Type *> frozenValue{nullptr};
+    // The freeze epoch of our manager, set once by getValue
+    // `freezeEpochOwner` is guarded by `valueMutex` and keeps it alive
+    mutable std::atomic<const detail::FreezeEpoch *> freezeEpoch{nullptr};
+    mutable std::shared_ptr<const detail::FreezeEpoch> freezeEpochOwner;
+
 public:
     std::weak_ptr<SettingData>
     getData()
@@ -435,11 +667,9 @@ public:
         auto connection = lockedSetting->updated.connect(func);
 
         if (autoInvoke) {
-            auto ptr = lockedSetting->unmarshalJSON();
+            // Stays null if there's no value
             rapidjson::Document d;
-            if (ptr != nullptr) {
-                d.CopyFrom(*ptr, d.GetAllocator());
-            }
+            lockedSetting->copyValue(d);
             connection.invoke(std::move(d), detail::onConnectArgs());
         }
 
@@ -462,11 +692,9 @@ public:
         auto connection = lockedSetting->updated.connect(func);
 
         if (autoInvoke) {
-            auto ptr = lockedSetting->unmarshalJSON();
+            // Stays null if there's no value
             rapidjson::Document d;
-            if (ptr != nullptr) {
-                d.CopyFrom(*ptr, d.GetAllocator());
-            }
+            lockedSetting->copyValue(d);
             connection.invoke(std::move(d), detail::onConnectArgs());
         }
 
@@ -485,8 +713,9 @@ public:
         }
 
         auto connection = lockedSetting->updated.connect(
-            [=](const rapidjson::Value &value, const SignalArgs &args) {
-                func(Deserialize<Type>::get(value), args);  //
+            [=, data = this->data](const rapidjson::Value &value,
+                                   const SignalArgs &args) {
+                func(*deserializeShared(data, value, args), args);  //
             });
 
         if (autoInvoke) {
@@ -509,8 +738,9 @@ public:
         }
 
         auto connection = lockedSetting->updated.connect(
-            [=](const rapidjson::Value &value, const SignalArgs &args) {
-                func(Deserialize<Type>::get(value), args);  //
+            [=, data = this->data](const rapidjson::Value &value,
+                                   const SignalArgs &args) {
+                func(*deserializeShared(data, value, args), args);  //
             });
 
         if (autoInvoke) {
@@ -531,8 +761,9 @@ public:
         }
 
         auto connection = lockedSetting->updated.connect(
-            [=](const rapidjson::Value &value, const SignalArgs &) {
-                func(Deserialize<Type>::get(value));  //
+            [=, data = this->data](const rapidjson::Value &value,
+                                   const SignalArgs &args) {
+                func(*deserializeShared(data, value, args));  //
             });
 
         if (autoInvoke) {
@@ -555,8 +786,9 @@ public:
         }
 
         auto connection = lockedSetting->updated.connect(
-            [=](const rapidjson::Value &value, const SignalArgs &) {
-                func(Deserialize<Type>::get(value));  //
+            [=, data = this->data](const rapidjson::Value &value,
+                                   const SignalArgs &args) {
+                func(*deserializeShared(data, value, args));  //
             });
 
         if (autoInvoke) {
@@ -660,6 +892,196 @@ public:
             std::make_unique<Signals::ScopedConnection>(std::move(connection)));
     }
 
+    // Connect with options: notifications are queued and delivered as
+    // described by `options` (e.g. on an executor)
+    void
+    connect(std::function<void(const Type &, const SignalArgs &)> func,
+            ConnectionOptions options)
+    {
+        this->connect(std::move(func), this->managedConnections,
+                      std::move(options));
+    }
+
+    template <typename ConnectionManager>
+    void
+    connect(std::function<void(const Type &, const SignalArgs &)> func,
+            ConnectionManager &userDefinedManagedConnections,
+            ConnectionOptions options)
+    {
+        this->connectWithOptions(
+            [func](Notification &n) {
+                func(*n.value, n.args);  //
+            },
+            true, std::move(options), userDefinedManagedConnections);
+    }
+
+    void
+    connect(std::function<void(const Type &)> func, ConnectionOptions options)
+    {
+        this->connect(std::move(func), this->managedConnections,
+                      std::move(options));
+    }
+
+    template <typename ConnectionManager>
+    void
+    connect(std::function<void(const Type &)> func,
+            ConnectionManager &userDefinedManagedConnections,
+            ConnectionOptions options)
+    {
+        this->connectWithOptions(
+            [func](Notification &n) {
+                func(*n.value);  //
+            },
+            true, std::move(options), userDefinedManagedConnections);
+    }
+
+    void
+    connectSimple(std::function<void(const SignalArgs &)> func,
+                  ConnectionOptions options)
+    {
+        this->connectSimple(std::move(func), this->managedConnections,
+                            std::move(options));
+    }
+
+    template <typename ConnectionManager>
+    void
+    connectSimple(std::function<void(const SignalArgs &)> func,
+                  ConnectionManager &userDefinedManagedConnections,
+                  ConnectionOptions options)
+    {
+        this->connectWithOptions(
+            [func](Notification &n) {
+                func(n.args);  //
+            },
+            false, std::move(options), userDefinedManagedConnections);
+    }
+
+private:
+    struct WaitState;
+
+public:
+    // Awaiters & blocking waits for changes of the value
+
+    // Awaits the next value that matches `predicate`. The coroutine is
+    // resumed on the thread that set the value.
+    // The setting is only connected to while the coroutine waits, or until
+    // the awaiter is destroyed (e.g. with its coroutine).
+    class ValueAwaiter
+    {
+    public:
+        ValueAwaiter(std::weak_ptr<SettingData> _data,
+                     std::function<bool(const Type &)> _predicate,
+                     Type _fallback)
+            : data(std::move(_data))
+            , predicate(std::move(_predicate))
+            , fallback(std::move(_fallback))
+            , state(std::make_shared<WaitState>())
+        {
+        }
+
+        ~ValueAwaiter()
+        {
+            if (this->state) {
+                this->state->cancel();
+            }
+        }
+
+        ValueAwaiter(ValueAwaiter &&) noexcept = default;
+        ValueAwaiter &operator=(ValueAwaiter &&) = delete;
+        ValueAwaiter(const ValueAwaiter &) = delete;
+        ValueAwaiter &operator=(const ValueAwaiter &) = delete;
+
+        bool
+        await_ready() const noexcept
+        {
+            return false;
+        }
+
+        bool
+        await_suspend(std::coroutine_handle<> handle)
+        {
+            this->state->handle = handle;
+
+            // The coroutine may be resumed (and this awaiter destroyed) on
+            // another thread as soon as we're connected
+            return startWaiting(this->data, this->predicate, this->state);
+        }
+
+        // The matching value, or the default value if the setting has gone
+        // away
+        Type
+        await_resume()
+        {
+            if (this->state->value) {
+                return *this->state->value;
+            }
+
+            return this->fallback;
+        }
+
+    private:
+        std::weak_ptr<SettingData> data;
+        std::function<bool(const Type &)> predicate;
+        Type fallback;
+        std::shared_ptr<WaitState> state;
+    };
+
+    // co_await setting.changed(): Wait for the next value
+    ValueAwaiter
+    changed() const
+    {
+        return this->nextValue([](const Type &) {
+            return true;
+        });
+    }
+
+    // co_await setting.nextValue(predicate): Wait for the next value matching
+    // `predicate`. The current value is not checked.
+    ValueAwaiter
+    nextValue(std::function<bool(const Type &)> predicate) const
+    {
+        return ValueAwaiter(this->data, std::move(predicate),
+                            this->defaultValue);
+    }
+
+    // Block until the value matches `predicate` (which may already be the
+    // case), or `timeout` has passed
+    // Must not be called from the thread that will set the value
+    template <typename Rep, typename Period>
+    std::optional<Type>
+    waitFor(std::function<bool(const Type &)> predicate,
+            std::chrono::duration<Rep, Period> timeout) const
+    {
+        auto state = std::make_shared<WaitState>();
+
+        // Connect first, so no value set in between is missed
+        if (!startWaiting(this->data, predicate, state)) {
+            return std::nullopt;
+        }
+
+        auto current = this->getValue();
+        if (predicate(current)) {
+            state->cancel();
+            return current;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->condition.wait_for(lock, timeout, [&state] {
+                return state->done;
+            });
+        }
+
+        state->cancel();
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        if (state->value) {
+            return *state->value;
+        }
+
+        return std::nullopt;
+    }
+
     // Static helper methods for one-offs (get or set setting)
     static const Type
     get(const std::string &path, SettingOption options = SettingOption::Default)
@@ -679,6 +1101,176 @@ public:
     }
 
 private:
+    // Deserialize a notified value once, no matter how many typed
+    // connections the setting has
+    static std::shared_ptr<const Type>
+    deserializeShared(const std::weak_ptr<SettingData> &data,
+                      const rapidjson::Value &value, const SignalArgs &args)
+    {
+        auto lockedSetting = data.lock();
+        if (!lockedSetting) {
+            return std::make_shared<const Type>(Deserialize<Type>::get(value));
+        }
+
+        return lockedSetting->template deserialize<Type>(value,
+                                                        args.updateIteration);
+    }
+
+    // Shared by a wait and the connection it waits on
+    struct WaitState {
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool done = false;
+        std::shared_ptr<const Type> value;
+        // Resumed once a value has been found, if set
+        std::coroutine_handle<> handle;
+        Signals::Connection connection;
+
+        void
+        attach(Signals::Connection &&newConnection)
+        {
+            {
+                std::unique_lock<std::mutex> lock(this->mutex);
+                if (!this->done) {
+                    this->connection = std::move(newConnection);
+                    return;
+                }
+            }
+
+            // Finished before we got here
+            newConnection.disconnect();
+        }
+
+        void
+        finish(std::shared_ptr<const Type> newValue)
+        {
+            Signals::Connection finished;
+            std::coroutine_handle<> waiting;
+
+            {
+                std::unique_lock<std::mutex> lock(this->mutex);
+                if (this->done) {
+                    return;
+                }
+                this->done = true;
+                this->value = std::move(newValue);
+                finished = std::move(this->connection);
+                waiting = this->handle;
+            }
+
+            this->condition.notify_all();
+            finished.disconnect();
+
+            if (waiting) {
+                waiting.resume();
+            }
+        }
+
+        void
+        cancel()
+        {
+            Signals::Connection finished;
+
+            {
+                std::unique_lock<std::mutex> lock(this->mutex);
+                if (this->done) {
+                    return;
+                }
+                this->done = true;
+                finished = std::move(this->connection);
+            }
+
+            finished.disconnect();
+        }
+    };
+
+    // Finishes `state` with the next value matching `predicate`
+    // Returns false if the setting has gone away
+    static bool
+    startWaiting(std::weak_ptr<SettingData> data,
+                 std::function<bool(const Type &)> predicate,
+                 std::shared_ptr<WaitState> state)
+    {
+        auto lockedSetting = data.lock();
+        if (!lockedSetting) {
+            return false;
+        }
+
+        auto connection = lockedSetting->updated.connect(
+            [state, predicate, data](const rapidjson::Value &value,
+                                     const SignalArgs &args) {
+                auto v = deserializeShared(data, value, args);
+                if (predicate(*v)) {
+                    // Keeps the state alive, finishing disconnects us
+                    auto self = state;
+                    self->finish(std::move(v));
+                }
+            });
+
+        state->attach(std::move(connection));
+
+        return true;
+    }
+
+    struct Notification {
+        // Null if the connection doesn't need the value
+        std::shared_ptr<const Type> value;
+        SignalArgs args;
+    };
+
+    template <typename ConnectionManager>
+    void
+    connectWithOptions(
+        typename detail::Strand<Notification>::Deliver deliver,
+        bool needsValue, ConnectionOptions options,
+        ConnectionManager &userDefinedManagedConnections)
+    {
+        auto lockedSetting = this->data.lock();
+        if (!lockedSetting) {
+            return;
+        }
+
+        auto strand = detail::Strand<Notification>::create(
+            std::move(options.executor), options.conflate,
+            std::move(deliver));
+
+        // Queued notifications are dropped once the connection is gone
+        auto guard =
+            std::make_shared<typename detail::Strand<Notification>::Guard>(
+                strand);
+
+        std::shared_ptr<detail::RateLimiter<Notification>> limiter;
+        if (options.rateLimit != RateLimit::None) {
+            limiter = detail::RateLimiter<Notification>::create(
+                strand, options.rateLimit, options.interval);
+        }
+
+        auto connection = lockedSetting->updated.connect(
+            [guard, limiter, needsValue, data = this->data](
+                const rapidjson::Value &value, const SignalArgs &args) {
+                Notification n{nullptr, args};
+                if (needsValue) {
+                    n.value = deserializeShared(data, value, args);
+                }
+                if (limiter) {
+                    limiter->push(std::move(n));
+                } else {
+                    guard->strand->push(std::move(n));
+                }
+            });
+
+        if (options.autoInvoke) {
+            Notification n{nullptr, detail::onConnectArgs()};
+            if (needsValue) {
+                n.value = std::make_shared<const Type>(this->getValue());
+            }
+            strand->push(std::move(n));
+        }
+
+        userDefinedManagedConnections.emplace_back(
+            std::make_unique<Signals::ScopedConnection>(std::move(connection)));
+    }
+
     std::vector<std::unique_ptr<Signals::ScopedConnection>> managedConnections;
 };
 
@@ -6,21 +6,26 @@
 #include <atomic>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <pajlada/serialize.hpp>
 #include <pajlada/settings/common.hpp>
+#include <pajlada/settings/detail/freezeepoch.hpp>
 #include <pajlada/settings/equal.hpp>
 #include <pajlada/settings/internal.hpp>
 #include <pajlada/settings/settingmanager.hpp>
 #include <pajlada/settings/signalargs.hpp>
 #include <pajlada/signals/signal.hpp>
 #include <string>
+#include <typeindex>
+#include <unordered_map>
 #include <vector>
 
 namespace pajlada::Settings {
 
 class SettingData
 {
-    SettingData(std::string _path, std::weak_ptr<SettingManager> _instance);
+    SettingData(std::string _path, std::weak_ptr<SettingManager> _instance,
+                std::shared_ptr<const detail::FreezeEpoch> _freezeEpoch);
 
     // Setting path (i.e. /a/b/c/3/d/e)
     const std::string path;
@@ -29,6 +34,9 @@ class SettingData
 
     std::atomic<int> updateIteration{};
 
+    // The freeze epoch of our manager, kept alive by us
+    const std::shared_ptr<const detail::FreezeEpoch> freezeEpoch;
+
 public:
     Signals::Signal<const rapidjson::Value &, const SignalArgs &> updated;
 
@@ -56,12 +64,43 @@ public:
             return false;
         }
 
-        auto jsonValue =
-            Serialize<Type>::get(v, locked->document.GetAllocator());
+        // Not the document's allocator, which is only safe to use while
+        // holding its lock
+        rapidjson::Document scratch;
+        auto jsonValue = Serialize<Type>::get(v, scratch.GetAllocator());
 
         return locked->set(this->path.c_str(), jsonValue, std::move(args));
     }
 
+    /// Write `v` if the stored value is still `expected` (nullptr: no value),
+    /// see `SettingManager::compareAndSet`
+    template <typename Type>
+    bool
+    compareAndSet(const rapidjson::Value *expected, const Type &v,
+                  SignalArgs args = SignalArgs())
+    {
+        auto locked = this->instance.lock();
+        if (!locked) {
+            return false;
+        }
+
+        rapidjson::Document scratch;
+        auto jsonValue = Serialize<Type>::get(v, scratch.GetAllocator());
+
+        return locked->compareAndSet(this->path.c_str(), expected, jsonValue,
+                                     std::move(args));
+    }
+
+    /// Copy the stored value into `out`, see `SettingManager::getCopy`
+    bool getCopy(rapidjson::Document &out) const;
+
+    /// Like `getCopy`, without waiting for the values queued for the apply
+    /// thread
+    bool copyValue(rapidjson::Document &out) const;
+
+    /// The stored value, in place
+    ///
+    /// Not synchronized with writers, see `SettingManager::get`
     rapidjson::Value *
     unmarshalJSON()
     {
@@ -72,21 +111,76 @@ public:
     std::optional<Type>
     unmarshal() const
     {
-        auto *ptr = this->get();
-
-        if (ptr == nullptr) {
+        rapidjson::Document json;
+        if (!this->copyValue(json)) {
             return std::nullopt;
         }
 
-        return Deserialize<Type>::get(*ptr);
+        return Deserialize<Type>::get(json);
     }
 
     int getUpdateIteration() const;
 
+    /// true if the manager of this setting is frozen
+    bool isFrozen() const;
+
+    /// Bumped whenever the manager of this setting is frozen or thawed, see
+    /// `SettingManager::freeze`
+    const std::shared_ptr<const detail::FreezeEpoch> &getFreezeEpoch() const;
+
+    /// Deserialize `value` as `Type`, sharing the result with everyone asking
+    /// for the same type during the same update iteration
+    ///
+    /// `value` must be the value notified in `iteration`
+    template <typename Type>
+    std::shared_ptr<const Type>
+    deserialize(const rapidjson::Value &value, int iteration)
+    {
+        if (auto cached = this->findDeserialized<Type>(iteration)) {
+            return cached;
+        }
+
+        auto result =
+            std::make_shared<const Type>(Deserialize<Type>::get(value));
+
+        std::lock_guard<std::mutex> lock(this->deserializedMutex);
+
+        this->deserialized[std::type_index(typeid(Type))] = DeserializedValue{
+            .iteration = iteration,
+            .value = result,
+        };
+
+        return result;
+    }
+
+    /// The value deserialized as `Type` during `iteration`, if any
+    template <typename Type>
+    std::shared_ptr<const Type>
+    findDeserialized(int iteration)
+    {
+        std::lock_guard<std::mutex> lock(this->deserializedMutex);
+
+        auto it = this->deserialized.find(std::type_index(typeid(Type)));
+        if (it == this->deserialized.end() ||
+            it->second.iteration != iteration) {
+            return nullptr;
+        }
+
+        return std::static_pointer_cast<const Type>(it->second.value);
+    }
+
 private:
     friend class SettingManager;
 
     rapidjson::Value *get() const;
+
+    struct DeserializedValue {
+        int iteration;
+        std::shared_ptr<const void> value;
+    };
+
+    std::mutex deserializedMutex;
+    std::unordered_map<std::type_index, DeserializedValue> deserialized;
 };
 
 }  // namespace pajlada::Settings
@@ -1,8 +1,14 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <pajlada/settings/detail/timerwheel.hpp>
+#include <pajlada/settings/notificationbatch.hpp>
 #include <pajlada/signals/scoped-connection.hpp>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -15,12 +21,15 @@ class SettingListener
 
 public:
     using Callback = std::function<void()>;
+    using CoalescedCallback =
+        std::function<void(const std::vector<std::string> &changedPaths)>;
 
     SettingListener() = default;
 
     ~SettingListener()
     {
         this->resetCB();
+        this->coalescer->setCB({}, {});
     }
 
     SettingListener(Callback callback)
@@ -42,6 +51,24 @@ public:
         this->cb = std::function<void()>();
     }
 
+    /// @brief Sets a callback that's called once per batch of changes
+    ///
+    /// Changes made within a `Settings::NotificationBatch` (e.g. loading a
+    /// file), or within `window` of the first change if it's non-zero, are
+    /// reported together in a single call, with the paths of the settings
+    /// that changed in the order they first changed.
+    ///
+    /// With a `window`, the callback is called on a shared timer thread.
+    ///
+    /// This is called in addition to the callback set with `setCB`.
+    void
+    setCoalescedCB(
+        CoalescedCallback callback,
+        std::chrono::milliseconds window = std::chrono::milliseconds(0))
+    {
+        this->coalescer->setCB(std::move(callback), window);
+    }
+
     SettingListener(SettingListener &&other) = delete;
     SettingListener &operator=(SettingListener &&other) = delete;
     SettingListener(const SettingListener &) = delete;
@@ -52,8 +79,12 @@ public:
     void
     addSetting(AnySetting &setting, bool autoInvoke = false)
     {
-        setting.connectSimple(std::bind(&SettingListener::invoke, this),
-                              this->managedConnections, autoInvoke);
+        setting.connectSimple(
+            [this, path = setting.getPath()](const auto &) {
+                this->invoke();
+                this->coalescer->add(path);
+            },
+            this->managedConnections, autoInvoke);
     }
 
     void
@@ -67,6 +98,132 @@ public:
     }
 
 private:
+    // Collects changed paths until the end of a batch or window. Deferred
+    // flushes only hold a weak reference, since they may outlive the listener.
+    class Coalescer : public std::enable_shared_from_this<Coalescer>
+    {
+    public:
+        void
+        setCB(CoalescedCallback callback, std::chrono::milliseconds _window)
+        {
+            {
+                std::unique_lock<std::mutex> lock(this->cbMutex);
+                this->cb = std::move(callback);
+            }
+
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->window = _window;
+            this->enabled = static_cast<bool>(this->cb);
+        }
+
+        void
+        add(const std::string &path)
+        {
+            std::chrono::milliseconds delay;
+
+            {
+                std::unique_lock<std::mutex> lock(this->mutex);
+
+                if (!this->enabled) {
+                    return;
+                }
+
+                if (std::find(this->changedPaths.begin(),
+                              this->changedPaths.end(),
+                              path) == this->changedPaths.end()) {
+                    this->changedPaths.push_back(path);
+                }
+
+                if (this->scheduled) {
+                    return;
+                }
+                this->scheduled = true;
+                delay = this->window;
+            }
+
+            std::weak_ptr<Coalescer> weak = this->shared_from_this();
+            auto flush = [weak] {
+                if (auto self = weak.lock()) {
+                    self->flush();
+                }
+            };
+
+            if (delay.count() > 0) {
+                Settings::detail::TimerWheel::instance().schedule(delay, flush);
+            } else {
+                Settings::NotificationBatch::defer(flush);
+            }
+        }
+
+    private:
+        void
+        flush()
+        {
+            {
+                std::unique_lock<std::mutex> lock(this->mutex);
+
+                if (this->flushing) {
+                    // Delivered by the running flush once its callback
+                    // returns, so callbacks never overlap
+                    this->flushAgain = true;
+                    return;
+                }
+                this->flushing = true;
+            }
+
+            while (true) {
+                std::vector<std::string> paths;
+
+                {
+                    std::unique_lock<std::mutex> lock(this->mutex);
+
+                    if (this->changedPaths.empty()) {
+                        this->flushing = false;
+                        this->flushAgain = false;
+                        return;
+                    }
+
+                    paths.swap(this->changedPaths);
+                    this->scheduled = false;
+                    this->flushAgain = false;
+                }
+
+                CoalescedCallback callback;
+                {
+                    std::unique_lock<std::mutex> lock(this->cbMutex);
+                    callback = this->cb;
+                }
+
+                // Called without our locks, the callback may change settings
+                // (adding paths) or replace itself
+                if (callback) {
+                    callback(paths);
+                }
+
+                std::unique_lock<std::mutex> lock(this->mutex);
+
+                if (!this->flushAgain) {
+                    this->flushing = false;
+                    return;
+                }
+            }
+        }
+
+        std::mutex cbMutex;
+        CoalescedCallback cb;
+
+        std::mutex mutex;
+        bool enabled = false;
+        std::chrono::milliseconds window{0};
+        bool scheduled = false;
+        // A flush is calling the callback, and another one came in meanwhile
+        bool flushing = false;
+        bool flushAgain = false;
+        std::vector<std::string> changedPaths;
+    };
+
+    std::shared_ptr<Coalescer> coalescer = std::make_shared<Coalescer>();
+
     std::vector<std::unique_ptr<Signals::ScopedConnection>> managedConnections;
 };
 
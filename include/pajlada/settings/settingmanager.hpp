@@ -4,19 +4,36 @@
 
 #include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <cinttypes>
 #include <filesystem>
+#include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <set>
+#include <pajlada/settings/backend.hpp>
 #include <pajlada/settings/backup.hpp>
+#include <pajlada/settings/changefeed.hpp>
+#include <pajlada/settings/changelog.hpp>
 #include <pajlada/settings/common.hpp>
+#include <pajlada/settings/detail/freezeepoch.hpp>
+#include <pajlada/settings/detail/writequeue.hpp>
 #include <pajlada/settings/signalargs.hpp>
+#include <pajlada/settings/snapshot.hpp>
+#include <pajlada/signals/signal.hpp>
 #include <vector>
 
 namespace pajlada::Settings {
 
+namespace detail {
+class FileWatcher;
+class PrefixIndex;
+struct PersistentNode;
+}  // namespace detail
+
 class SettingData;
+class Transaction;
 
 class SettingManager
 {
@@ -24,14 +41,7 @@ public:
     SettingManager();
     ~SettingManager();
 
-    enum class LoadError {
-        NoError,
-        CannotOpenFile,
-        FileHandleError,
-        FileReadError,
-        FileSeekError,
-        JSONParseError,
-    };
+    using LoadError = Settings::LoadError;
 
     enum class SaveResult : std::uint8_t {
         /// Saving the settings to a file failed
@@ -50,11 +60,228 @@ public:
     static void gPP(const std::string &prefix = std::string());
     static std::string stringify(const rapidjson::Value &v);
 
+    /// The value at `path`, in place
+    ///
+    /// Not synchronized with writers (e.g. the apply thread or a hot reload),
+    /// use `getCopy` if the document might be written concurrently.
     rapidjson::Value *get(const char *path);
     bool set(const char *path, const rapidjson::Value &value,
              SignalArgs args = SignalArgs());
 
+    /// Set `value` at `path` if the value there is still equal to `expected`
+    /// (nullptr: there is no value at `path`)
+    ///
+    /// The comparison and the write happen under the document lock, so no
+    /// other write comes in between. Values queued for the apply thread
+    /// aren't looked at.
+    ///
+    /// @returns false if the value differs or the manager is frozen
+    bool compareAndSet(const char *path, const rapidjson::Value *expected,
+                       const rapidjson::Value &value,
+                       SignalArgs args = SignalArgs());
+
+    /// Copy the value at `path` into `out`, under the document lock
+    ///
+    /// Waits for the values this thread has queued for the apply thread
+    /// first, see `flush`.
+    ///
+    /// @returns false if there's no value at `path`
+    bool getCopy(const char *path, rapidjson::Document &out);
+
+private:
+    friend class SettingData;
+
+    // `getCopy` without waiting for queued values
+    bool copyValue(const char *path, rapidjson::Document &out);
+
+public:
+
+    /// Invoked for every value set in the document, after it has been set
+    ///
+    /// Loading or reloading the document is reported as a single update of
+    /// the root (path "")
+    Signals::Signal<const std::string &, const rapidjson::Value &,
+                    const SignalArgs &>
+        updated;
+
+    /// Invoked at the start of every save, before anything is written
+    ///
+    /// Lets values that are kept outside of the document (e.g. by an
+    /// `Accumulator`) be written into it first. Saves started by a handler are
+    /// skipped, the save that invoked it persists their changes.
+    Signals::NoArgSignal aboutToSave;
+
+    using PrefixCallback =
+        std::function<void(const std::string &path,
+                           const rapidjson::Value &value, const SignalArgs &)>;
+
+    /// Call `callback` for every change at or below `prefix` (e.g.
+    /// "/channels/"), without needing a `Setting` for each path
+    ///
+    /// The callback receives the path and value that was set. If an object
+    /// above a subscribed path is set (e.g. "/channels" for a subscription to
+    /// "/channels/forsen"), the subscription is notified with its own path
+    /// and its part of the new value, which is null if it's not in there.
+    ///
+    /// Finding the subscribers of a change costs O(depth of the path).
+    ///
+    /// @returns The connection, which must be disconnected (e.g. by wrapping
+    ///          it in a `Signals::ScopedConnection`) to unsubscribe
+    Signals::Connection connectPrefix(const std::string &prefix,
+                                      PrefixCallback callback);
+
+    /// The change feed of this manager, created on first use
+    ///
+    /// Changes are only queued once the feed exists.
+    ChangeFeed &changeFeed();
+
+    /// The sequence number of the most recent change, see `Change::sequence`
+    std::uint64_t currentSequence() const;
+
+    /// The changes (sets, removals and loads) made after change `sequence`
+    ///
+    /// The most recent changes are kept in a ring, if `sequence` is too old
+    /// for that the answer is to resync. Start with `currentSequence()`.
+    ChangesSince changesSince(std::uint64_t sequence) const;
+
+    /// Set how many changes are kept for `changesSince` (1024 by default)
+    ///
+    /// Drops the changes kept so far.
+    void setChangeLogCapacity(std::size_t capacity);
+
+    /// An immutable version of the current document, see `Snapshot`
+    ///
+    /// The first call copies the document. From then on, the manager keeps a
+    /// persistent version of the document up to date, and a snapshot costs
+    /// O(number of changes since the previous one).
+    ///
+    /// A snapshot is a consistent read view: it holds either all or none of
+    /// the values set by a single `set` or `Transaction`.
+    Snapshot snapshot();
+
+    /// Make the document equal to `snapshot` again
+    ///
+    /// Only the settings whose values differ from the snapshot are notified.
+    void restore(const Snapshot &snapshot);
+
+    using RemoteWriter = std::function<void(const std::string &path,
+                                            const rapidjson::Value &value)>;
+
+    /// Send values of `SettingOption::Remote` settings to `writer` instead of
+    /// setting them locally, see `RemoteClient`
+    void setRemoteWriter(RemoteWriter writer);
+
+    /// Run `stage` with a new `Transaction` and commit it afterwards
+    ///
+    /// If `stage` throws, nothing is applied and the exception is rethrown.
+    ///
+    /// @returns false if the manager is frozen
+    bool transaction(const std::function<void(Transaction &)> &stage);
+
+    /// Make the document and the registry of settings immutable
+    ///
+    /// Until `thaw` is called, everything that would change the document
+    /// (`set`, `Setting::setValue`, removals, loading, `restore`) fails
+    /// without doing anything. In return, `Setting::getValue` only resolves
+    /// a value once after freezing; from then on it's two atomic loads and a
+    /// pointer dereference, without locks or reference counting. Finding the
+    /// data of an existing setting doesn't lock either.
+    ///
+    /// Settings created while frozen for paths that had no setting yet are
+    /// registered by `thaw`.
+    void freeze();
+
+    /// Make the manager mutable again
+    ///
+    /// No other thread may create settings of this manager while it's being
+    /// thawed.
+    void thaw();
+
+    bool isFrozen() const;
+
+    /// Apply the values passed to `set` on a single thread of this manager
+    ///
+    /// While enabled, `set` (and so `Setting::setValue`) only queues a copy of
+    /// the value and returns true. The apply thread applies queued values in
+    /// the order they were queued, in batches: each batch takes the document
+    /// lock once, saves once (if the manager saves on every setting change)
+    /// and notifies in one `NotificationBatch`. Use `flush` to wait until a
+    /// value has been applied. Values still queued when the manager is frozen
+    /// are dropped.
+    ///
+    /// Disabling waits for the values this thread has queued.
+    void setApplyThreadEnabled(bool enabled = true);
+
+    /// Wait until all values this thread has passed to `set` have been
+    /// applied by the apply thread
+    ///
+    /// Returns right away if the apply thread isn't enabled, or if called from
+    /// it (e.g. from a notification).
+    void flush();
+
 private:
+    // Called on the apply thread
+    void applyWrites(std::vector<detail::WriteQueue::Write> &writes);
+
+    std::mutex writeQueueMutex;
+    // Created the first time the apply thread is enabled, and kept until the
+    // manager is destroyed
+    std::unique_ptr<detail::WriteQueue> writeQueue;
+    std::atomic<bool> applyThreadEnabled{false};
+
+    friend class Transaction;
+
+    // Called from Transaction::commit, consumes its staged writes
+    // Returns false if the manager is frozen
+    bool commit(Transaction &transaction);
+
+    std::atomic<bool> frozen{false};
+    // Shared with our SettingData, see `detail::FreezeEpoch`
+    const std::shared_ptr<detail::FreezeEpoch> freezeEpoch =
+        std::make_shared<detail::FreezeEpoch>(1);
+
+    // Serializes writes to the document, so a transaction is applied without
+    // other writes in between
+    std::mutex documentMutex;
+
+    // Hands out the next sequence number for a change of `path`, and passes
+    // the change on to the change log and feed
+    void recordChange(const std::string &path, Change::Kind kind);
+
+    // Invokes `updated` and the prefix subscribers
+    void notifyObservers(const std::string &path, const rapidjson::Value &value,
+                         const SignalArgs &args);
+
+    std::unique_ptr<detail::PrefixIndex> prefixIndex;
+
+    std::atomic<std::uint64_t> changeSequence{0};
+
+    ChangeLog changeLog{1024};
+
+    std::mutex changeFeedMutex;
+    std::unique_ptr<ChangeFeed> ownedChangeFeed;
+    // Published once `ownedChangeFeed` has been created
+    std::atomic<ChangeFeed *> activeChangeFeed{nullptr};
+
+    // Counts the writes to the document and remembers which paths have to be
+    // brought up to date in its persistent version before the next snapshot
+    // Must be called with `documentMutex` held, right after writing `path`
+    void documentChanged(const std::string &path);
+
+    // The fields below are guarded by `documentMutex`
+    std::uint64_t documentVersion = 0;
+    // Set by the first call to `snapshot`
+    bool snapshotsEnabled = false;
+    // Persistent version of the document, behind by `staleSnapshotPaths`
+    std::shared_ptr<const detail::PersistentNode> snapshotRoot;
+    std::vector<std::string> staleSnapshotPaths;
+    // Set if `snapshotRoot` has to be rebuilt from scratch
+    bool snapshotRebuildNeeded = true;
+    // Set while `reload` reads the file, see `replaceDocument`
+    bool reloading = false;
+    // The paths written while `reloading`
+    std::vector<std::string> writtenDuringReload;
+
     // Called from set
     void notifyUpdate(const std::string &path, const rapidjson::Value &value,
                       SignalArgs args = SignalArgs());
@@ -62,6 +289,36 @@ private:
     // Called from load
     void notifyLoadedValues();
 
+    // Replace the document with `newDocument`, notifying only the settings
+    // whose values have changed
+    // `reloadedFrom` is set by `reload`: values written while the file was
+    // being read are kept and stay dirty, everything else matches the file
+    void replaceDocument(rapidjson::Document &newDocument,
+                         SignalArgs::Source source,
+                         const std::filesystem::path *reloadedFrom = nullptr);
+
+    // Puts the values written while `reloading` into `newDocument` and marks
+    // them dirty, the rest of the document was loaded from `path`
+    // Must be called with `documentMutex` held
+    void keepWritesDuringReload(rapidjson::Document &newDocument,
+                                const std::filesystem::path &path);
+
+    // Serializes reloads
+    std::mutex reloadMutex;
+
+    friend class RemoteClient;
+    friend class RemoteServer;
+
+    std::mutex remoteMutex;
+    RemoteWriter remoteWriter;
+
+    // Called by `documentChanged`, so writes are observed in the order they
+    // were applied to the document. Gets the written path and the value now
+    // at it, or the closest parent that's left if the value was removed.
+    // Guarded by `documentMutex`
+    RemoteWriter documentObserver;
+    void setDocumentObserver(RemoteWriter observer);
+
 public:
     // Useful array helper methods
     static rapidjson::SizeType arraySize(const std::string &path);
@@ -119,8 +376,70 @@ public:
     // Save to given path
     SaveResult saveAs(const std::filesystem::path &path);
 
+    /// Load the settings file again, notifying only the settings whose values
+    /// have changed
+    ///
+    /// Values that are not in the file anymore are notified as null.
+    LoadError reload();
+
+    /// Call `reload` whenever the settings file is changed by someone else
+    ///
+    /// Bursts of changes are collapsed until the file has been quiet for
+    /// `debounce`. Our own saves are ignored. Reloads happen on a background
+    /// thread.
+    ///
+    /// Only supported on Linux.
+    ///
+    /// @returns true if the file is being watched
+    bool setHotReloadEnabled(
+        bool enabled = true,
+        std::chrono::milliseconds debounce = std::chrono::milliseconds(50));
+
+public:
+    /// Replace the backend used to load & save the document
+    ///
+    /// The default backend is a `JsonFileBackend`
+    void setBackend(std::unique_ptr<Backend> newBackend);
+    Backend &getBackend();
+
+    /// Store the subtree at `pointer` (e.g. "/highlights") in its own file
+    ///
+    /// Only has an effect if the current backend is a `JsonFileBackend`, see
+    /// `JsonFileBackend::addShard`
+    void addShard(const std::string &pointer,
+                  const std::filesystem::path &path);
+
 private:
-    bool writeTo(const std::filesystem::path &path);
+    // Remember that the value at `path` has to be persisted by the next save
+    void markDirty(const std::string &path);
+
+    std::unique_ptr<Backend> backend;
+
+    std::mutex dirtyMutex;
+
+    // Serializes saves, taken before `documentMutex`
+    std::mutex saveMutex;
+
+    /// JSON pointers of all values changed since the last successful save
+    std::set<std::string> dirtyPaths;
+
+    /// Set if the next save must persist the full document (e.g. after a
+    /// `clear`), regardless of `dirtyPaths`
+    bool fullPersistNeeded = false;
+
+    /// The path the document was last loaded from or saved to
+    std::filesystem::path persistedPath;
+
+    // Starts watching `filePath` if hot reload is enabled
+    // Must be called with `watcherMutex` held
+    void restartWatcher();
+
+    std::mutex watcherMutex;
+
+    bool hotReloadEnabled = false;
+    std::chrono::milliseconds hotReloadDebounce{};
+
+    std::unique_ptr<detail::FileWatcher> watcher;
 
 public:
     // Functions prefixed with g are static functions that work
@@ -155,11 +474,19 @@ private:
                 static_cast<uint64_t>(testSaveMethod)) != 0;
     }
 
-    Backup::Options backup;
-
 public:
     void setBackupEnabled(bool enabled = true);
     void setBackupSlots(uint8_t numSlots);
+    void setBackupRotation(Backup::Rotation rotation);
+    void setBackupDeltasEnabled(bool enabled = true);
+
+    /// Set how hard saves try to get onto the disk before `save` returns
+    void setDurability(Backup::Durability durability);
+
+    /// If enabled, moving the previous save into the backup slots is done on
+    /// a background thread after `save` returns, see
+    /// `Backup::saveWithDeferredBackup`
+    void setBackupDeferred(bool deferred = true);
 
     static const std::shared_ptr<SettingManager> &
     getInstance()
@@ -173,15 +500,27 @@ private:
     std::shared_ptr<SettingData> getSetting(const std::string &path);
 
 public:
+    /// Guarded by `documentMutex`, see `get`
     rapidjson::Document document;
 
 private:
+    // The "default path", guarded by `filePathMutex`
     std::filesystem::path filePath = "settings.json";
+    mutable std::mutex filePathMutex;
+
+    std::filesystem::path currentPath() const;
 
     std::mutex settingsMutex;
 
     //       path         setting
     std::map<std::string, std::shared_ptr<SettingData>> settings;
+
+    // Settings created while frozen, moved into `settings` by `thaw`
+    std::map<std::string, std::shared_ptr<SettingData>> frozenSettings;
+
+    // The number of `getSetting` calls that might be reading `settings`
+    // without `settingsMutex` because we're frozen, see `thaw`
+    std::atomic<int> lockFreeReaders{0};
 };
 
 }  // namespace pajlada::Settings
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <rapidjson/document.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <pajlada/serialize.hpp>
+#include <pajlada/signals/signal.hpp>
+#include <string>
+
+namespace pajlada::Settings {
+
+class SettingManager;
+
+/// @brief Publishes immutable snapshots of a `SettingManager`'s document into
+/// shared memory, so other processes on the same host can read it without
+/// loading & parsing the settings file themselves
+///
+/// Every snapshot lives in its own segment (`<name>.<generation>`). The
+/// newest generation is stored in the `<name>` segment. Readers that still
+/// have an older snapshot mapped keep it until they refresh.
+///
+/// Not supported on Windows.
+class SharedSnapshotPublisher
+{
+public:
+    /// @param name Name of the shared memory segment, e.g. "/my-app-settings"
+    /// @param publishOnChange Publish a new snapshot when values are set in
+    ///                        `owner`
+    /// @param publishDelay Values set within this delay of each other are
+    ///                     published together in one snapshot
+    SharedSnapshotPublisher(
+        std::shared_ptr<SettingManager> owner, std::string name,
+        bool publishOnChange = true,
+        std::chrono::milliseconds publishDelay = std::chrono::milliseconds(10));
+    ~SharedSnapshotPublisher();
+
+    SharedSnapshotPublisher(const SharedSnapshotPublisher &) = delete;
+    SharedSnapshotPublisher &operator=(const SharedSnapshotPublisher &) =
+        delete;
+
+    /// Publish the current state of the document as a new generation
+    ///
+    /// @returns true if the snapshot was published
+    bool publish();
+
+    /// The generation of the newest published snapshot (0 if none)
+    std::uint64_t generation() const;
+
+private:
+    // Shared with the timer of a scheduled publish, which may fire after we
+    // are gone
+    struct PendingPublish {
+        std::mutex mutex;
+        // nullptr once the publisher is destroyed, guarded by `mutex`
+        SharedSnapshotPublisher *publisher;
+        std::atomic<bool> scheduled{false};
+    };
+
+    void schedulePublish();
+
+    std::shared_ptr<SettingManager> owner;
+    std::string name;
+    const std::chrono::milliseconds publishDelay;
+
+    std::mutex mutex;
+
+    std::shared_ptr<PendingPublish> pending;
+
+    /// Mapping of the `name` segment
+    void *control = nullptr;
+
+    std::uint64_t currentGeneration = 0;
+
+    Signals::Connection updatedConnection;
+};
+
+/// @brief Reads snapshots published by a `SharedSnapshotPublisher`
+///
+/// Values are looked up in the mapped snapshot directly; only the values
+/// below the requested path are parsed. Use `Setting::getValue(reader)` to
+/// resolve a setting from the snapshot.
+///
+/// A reader must not be used from multiple threads at once.
+class SharedSnapshotReader
+{
+public:
+    explicit SharedSnapshotReader(std::string name);
+    ~SharedSnapshotReader();
+
+    SharedSnapshotReader(const SharedSnapshotReader &) = delete;
+    SharedSnapshotReader &operator=(const SharedSnapshotReader &) = delete;
+
+    /// Map the newest snapshot if a new one has been published since the last
+    /// call
+    ///
+    /// @returns true if a snapshot is mapped
+    bool refresh();
+
+    /// The generation of the mapped snapshot (0 if none)
+    std::uint64_t generation() const;
+
+    /// Copy the value at `path` out of the mapped snapshot into `out`
+    ///
+    /// @returns false if there's no value at `path`
+    bool getJSON(const std::string &path, rapidjson::Document &out) const;
+
+    template <typename Type>
+    std::optional<Type>
+    get(const std::string &path) const
+    {
+        rapidjson::Document document;
+        if (!this->getJSON(path, document)) {
+            return std::nullopt;
+        }
+
+        bool error = false;
+        auto value = Deserialize<Type>::get(document, &error);
+        if (error) {
+            return std::nullopt;
+        }
+
+        return value;
+    }
+
+private:
+    void unmapSnapshot();
+
+    std::string name;
+
+    void *control = nullptr;
+
+    const char *snapshot = nullptr;
+    std::size_t snapshotSize = 0;
+    std::uint64_t snapshotGeneration = 0;
+};
+
+}  // namespace pajlada::Settings
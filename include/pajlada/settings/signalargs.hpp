@@ -19,6 +19,14 @@ struct SignalArgs {
 
     bool writeToFile{true};
     bool compareBeforeSet{false};
+
+    /// Set for `SettingOption::Remote` settings: the value is sent to the
+    /// owning process instead of being written locally
+    bool remote{false};
+
+    /// Set by the setting being notified, the update iteration the notified
+    /// value belongs to
+    int updateIteration{-1};
 };
 
 }  // namespace pajlada::Settings
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <rapidjson/document.h>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <pajlada/serialize.hpp>
+#include <string>
+
+namespace pajlada::Settings {
+
+namespace detail {
+struct PersistentNode;
+}  // namespace detail
+
+class SettingManager;
+
+/// @brief An immutable, cheap to copy version of a `SettingManager`'s
+/// document, see `SettingManager::snapshot`
+///
+/// Snapshots share all unchanged parts of the document with each other, so
+/// taking one costs O(1) and keeping many around only costs memory for what
+/// changed in between. Use `Setting::getValue(snapshot)` to resolve a setting
+/// from a snapshot.
+///
+/// A snapshot also serves as a read transaction: reading several settings
+/// from one snapshot gives values from the same version of the document,
+/// while writers carry on without waiting for the readers.
+///
+/// A snapshot can be read from multiple threads at once.
+class Snapshot
+{
+public:
+    /// An empty snapshot, holding no values
+    Snapshot() = default;
+
+    /// true if the snapshot holds no values
+    bool empty() const;
+
+    /// The version of the document this snapshot shows
+    ///
+    /// Every write to the document makes a new version, so two snapshots with
+    /// the same version hold the same values.
+    std::uint64_t version() const;
+
+    /// Copy the value at `path` into `out`
+    ///
+    /// @returns false if there's no value at `path`
+    bool getJSON(const std::string &path, rapidjson::Document &out) const;
+
+    template <typename Type>
+    std::optional<Type>
+    get(const std::string &path) const
+    {
+        rapidjson::Document document;
+        if (!this->getJSON(path, document)) {
+            return std::nullopt;
+        }
+
+        bool error = false;
+        auto value = Deserialize<Type>::get(document, &error);
+        if (error) {
+            return std::nullopt;
+        }
+
+        return value;
+    }
+
+    /// Copy the whole document into `out`
+    void toDocument(rapidjson::Document &out) const;
+
+private:
+    friend class SettingManager;
+
+    Snapshot(std::shared_ptr<const detail::PersistentNode> root,
+             std::uint64_t version);
+
+    std::shared_ptr<const detail::PersistentNode> root;
+    std::uint64_t documentVersion = 0;
+};
+
+}  // namespace pajlada::Settings
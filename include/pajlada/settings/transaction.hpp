@@ -0,0 +1,118 @@
+#pragma once
+
+#include <rapidjson/document.h>
+
+#include <pajlada/serialize.hpp>
+#include <pajlada/settings/setting.hpp>
+#include <pajlada/settings/settingmanager.hpp>
+#include <pajlada/settings/signalargs.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace pajlada::Settings {
+
+/// @brief Stages writes to a `SettingManager` and applies them all at once
+///
+/// Nothing is written to the document until `commit` is called. Committing:
+/// 1. applies all staged values while holding the document lock of the
+///    manager, so no other write is interleaved with them,
+/// 2. saves once (if the manager saves on every setting change),
+/// 3. notifies the changed settings in a single `NotificationBatch`, after
+///    all values have been applied.
+///
+/// If applying the values throws, the previous values are restored and the
+/// exception is rethrown. If saving throws, the previous values are restored
+/// at the paths nobody else has written to since, and the exception is
+/// rethrown. A frozen manager refuses the commit and the values stay staged.
+/// A transaction that's destroyed without being committed is discarded.
+///
+/// Values staged for a `Setting` follow its options like `Setting::setValue`
+/// does. The setting must outlive the commit.
+///
+/// A transaction must only be used from one thread at a time.
+class Transaction
+{
+public:
+    /// A transaction on the global `SettingManager`
+    Transaction();
+    explicit Transaction(SettingManager &manager);
+
+    Transaction(const Transaction &) = delete;
+    Transaction &operator=(const Transaction &) = delete;
+
+    /// Stage `value` to be set at `path`. Staging a path again replaces the
+    /// staged value.
+    void set(const std::string &path, const rapidjson::Value &value,
+             SignalArgs args = SignalArgs());
+
+    template <typename Type>
+    void
+    setValue(const std::string &path, const Type &value,
+             SignalArgs args = SignalArgs())
+    {
+        rapidjson::Document d;
+        auto jsonValue = Serialize<Type>::get(value, d.GetAllocator());
+
+        this->set(path, jsonValue, std::move(args));
+    }
+
+    template <typename Type>
+    void
+    setValue(const Setting<Type> &setting, const Type &value,
+             SignalArgs args = SignalArgs())
+    {
+        if (setting.optionEnabled(SettingOption::CompareBeforeSet)) {
+            args.compareBeforeSet = true;
+        }
+
+        if (setting.optionEnabled(SettingOption::Remote)) {
+            args.remote = true;
+        }
+
+        bool local = setting.optionEnabled(SettingOption::DoNotWriteToJSON);
+        if (local) {
+            args.writeToFile = false;
+        }
+
+        this->setValue(setting.getPath(), value, std::move(args));
+
+        if (local) {
+            // The value only lives in the setting
+            this->findWrite(setting.getPath()).storeLocally =
+                [&setting, value] {
+                    setting.storeLocally(value);
+                };
+        }
+    }
+
+    /// Apply all staged values, see above
+    ///
+    /// @returns false if the manager is frozen
+    bool commit();
+
+    /// Drop all staged values
+    void discard();
+
+    bool empty() const;
+
+private:
+    friend class SettingManager;
+
+    struct Write {
+        std::string path;
+        rapidjson::Document value;
+        SignalArgs args;
+        // Set for values that aren't written to the document
+        std::function<void()> storeLocally;
+    };
+
+    // The staged write at `path`, which must exist
+    Write &findWrite(const std::string &path);
+
+    SettingManager &manager;
+
+    std::vector<Write> writes;
+};
+
+}  // namespace pajlada::Settings
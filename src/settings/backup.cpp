@@ -1,68 +1,452 @@
+#include <fstream>
+#include <iterator>
 #include <pajlada/settings/backup.hpp>
+#include <pajlada/settings/detail/delta.hpp>
 #include <pajlada/settings/detail/realpath.hpp>
 #include <pajlada/settings/detail/rename.hpp>
+#include <pajlada/settings/detail/sync.hpp>
 
 namespace pajlada::Settings::Backup {
 
-void
-saveWithBackup(const std::filesystem::path &path, Options options,
+namespace {
+
+std::filesystem::path
+resolvePath(const std::filesystem::path &path, const Options &options,
+            std::error_code &ec)
+{
+    if (options.realPathCache != nullptr) {
+        return options.realPathCache->resolve(path, ec);
+    }
+
+    return detail::RealPath(path, ec);
+}
+
+std::filesystem::path
+slotPath(const std::filesystem::path &path, std::uint8_t slotIndex)
+{
+    std::filesystem::path p(path);
+    p += ".bkp-" + std::to_string(slotIndex);
+    return p;
+}
+
+std::filesystem::path
+ringIndexPath(const std::filesystem::path &path)
+{
+    std::filesystem::path p(path);
+    p += ".bkp-index";
+    return p;
+}
+
+// The newest backup of a ring rotation is always a full copy
+bool
+isFullBackup(const std::filesystem::path &slot)
+{
+    std::ifstream fh(slot.c_str(), std::ios::in | std::ios::binary);
+    if (!fh) {
+        return false;
+    }
+
+    char head[16] = {};
+    fh.read(head, sizeof(head));
+
+    return !detail::isDelta(
+        std::string_view(head, static_cast<std::size_t>(fh.gcount())));
+}
+
+// Returns the slot holding the newest backup of a ring rotation
+std::uint8_t
+readNewestRingSlot(const std::filesystem::path &path, std::uint8_t numSlots)
+{
+    std::ifstream fh(ringIndexPath(path).c_str(), std::ios::in);
+    unsigned newest = 0;
+    if (!fh || !(fh >> newest) || newest < 1 || newest > numSlots) {
+        // No (usable) index: The slots are laid out like a shift rotation,
+        // where `.bkp-1` is the newest backup
+        return 1;
+    }
+
+    // `rotateRing` writes the index before moving the save into the slot. If
+    // it crashed in between, the slot is still missing or holds the oldest
+    // (delta) backup, and the previous newest one is in the next slot.
+    auto previous = static_cast<std::uint8_t>(newest % numSlots + 1);
+    if (!isFullBackup(slotPath(path, static_cast<std::uint8_t>(newest))) &&
+        isFullBackup(slotPath(path, previous))) {
+        return previous;
+    }
+
+    return static_cast<std::uint8_t>(newest);
+}
+
+// Write the new contents to the temporary file of `path`
+std::filesystem::path
+writeTemporary(const std::filesystem::path &path, Options options,
                const std::function<void(const std::filesystem::path &,
                                         std::error_code &ec)> &doWrite,
                std::error_code &ec)
 {
-    std::filesystem::path realPath = detail::RealPath(path, ec);
+    std::filesystem::path tmpPath(path);
+    tmpPath += ".tmp";
+
+    doWrite(tmpPath, ec);
+    if (ec) {
+        return tmpPath;
+    }
+
+    if (options.durability != Durability::None) {
+        detail::syncFile(tmpPath, ec);
+    }
+
+    return tmpPath;
+}
+
+void
+syncParentDirectory(const std::filesystem::path &realPath, Options options,
+                    std::error_code &ec)
+{
+    if (options.durability == Durability::SyncFileAndDirectory) {
+        detail::syncDirectory(realPath.parent_path(), ec);
+    }
+}
+
+// Replaced through a temporary file like the backups themselves, so a crash
+// never leaves a truncated index behind
+void
+writeNewestRingSlot(const std::filesystem::path &path, std::uint8_t newest,
+                    const Options &options, std::error_code &ec)
+{
+    auto indexPath = ringIndexPath(path);
+
+    auto tmpPath = writeTemporary(
+        indexPath, options,
+        [newest](const auto &target, auto &writeEc) {
+            std::ofstream fh(target.c_str(), std::ios::out | std::ios::trunc);
+            fh << static_cast<unsigned>(newest);
+            fh.close();
+            if (!fh) {
+                writeEc = std::make_error_code(std::errc::io_error);
+            }
+        },
+        ec);
     if (ec) {
         return;
     }
-    std::filesystem::path tmpPath(path);
+
+    detail::renameFile(tmpPath, indexPath, ec);
+    if (ec) {
+        return;
+    }
+
+    syncParentDirectory(indexPath, options, ec);
+}
+
+bool
+readFile(const std::filesystem::path &path, std::string &contents)
+{
+    std::ifstream fh(path.c_str(), std::ios::in | std::ios::binary);
+    if (!fh) {
+        return false;
+    }
+
+    contents.assign(std::istreambuf_iterator<char>(fh),
+                    std::istreambuf_iterator<char>());
+
+    return !fh.bad();
+}
+
+// Replace the full backup at `olderPath` with a delta against `newerPath`
+void
+encodeAsDelta(const std::filesystem::path &olderPath,
+              const std::filesystem::path &newerPath)
+{
+    std::string older;
+    std::string newer;
+    if (!readFile(olderPath, older) || detail::isDelta(older) ||
+        !readFile(newerPath, newer)) {
+        return;
+    }
+
+    auto delta = detail::makeDelta(newer, older);
+    if (delta.size() >= older.size()) {
+        // Not worth it, keep the full copy
+        return;
+    }
+
+    std::filesystem::path tmpPath(olderPath);
     tmpPath += ".tmp";
 
-    std::filesystem::path bkpPath(path);
-    bkpPath += ".bkp";
+    {
+        std::ofstream fh(tmpPath.c_str(),
+                         std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!fh) {
+            return;
+        }
+
+        fh.write(delta.data(), static_cast<std::streamsize>(delta.size()));
+        if (!fh) {
+            return;
+        }
+    }
+
+    std::error_code ec;
+    detail::renameFile(tmpPath, olderPath, ec);
+}
 
-    doWrite(tmpPath, ec);
+// `previousPath` is the file holding the contents that are being replaced
+void
+rotateShift(const std::filesystem::path &path,
+            const std::filesystem::path &previousPath, Options options,
+            std::error_code &ec)
+{
+    std::filesystem::path firstBkpPath = slotPath(path, 1);
+
+    if (options.numSlots > 1) {
+        std::filesystem::path topBkpPath =
+            resolvePath(slotPath(path, options.numSlots), options, ec);
+        if (ec) {
+            return;
+        }
+        // Remove top slot backup
+        std::filesystem::remove(topBkpPath, ec);
+
+        // Shift backups one slot up
+        for (uint8_t slotIndex = options.numSlots - 1; slotIndex >= 1;
+             --slotIndex) {
+            std::filesystem::path p1 =
+                resolvePath(slotPath(path, slotIndex), options, ec);
+            if (ec) {
+                return;
+            }
+            std::filesystem::path p2 =
+                resolvePath(slotPath(path, slotIndex + 1), options, ec);
+            if (ec) {
+                return;
+            }
+            detail::renameFile(p1, p2, ec);
+        }
+    }
+
+    // Move current save to first backup slot
+    detail::renameFile(previousPath, firstBkpPath, ec);
+
+    if (options.deltas && !ec && options.numSlots > 1) {
+        std::error_code realPathEc;
+        auto secondBkpPath =
+            resolvePath(slotPath(path, 2), options, realPathEc);
+        if (!realPathEc) {
+            encodeAsDelta(secondBkpPath, firstBkpPath);
+        }
+    }
+}
+
+void
+rotateRing(const std::filesystem::path &path,
+           const std::filesystem::path &previousPath, Options options,
+           std::error_code &ec)
+{
+    if (options.numSlots == 0) {
+        return;
+    }
+
+    auto newest = readNewestRingSlot(path, options.numSlots);
+
+    // Slots are written in descending order, so the slot after the newest
+    // one holds the oldest backup
+    std::uint8_t target = newest == 1 ? options.numSlots : newest - 1;
+
+    auto targetPath = resolvePath(slotPath(path, target), options, ec);
+    if (ec) {
+        return;
+    }
+
+    // Point the index at the target first: a crash before the move leaves
+    // an index that `readNewestRingSlot` can tell is ahead of the slots,
+    // while a crash after it would make the next save overwrite the newest
+    // backup
+    writeNewestRingSlot(path, target, options, ec);
+    if (ec) {
+        return;
+    }
+
+    // Move current save over the oldest backup
+    detail::renameFile(previousPath, targetPath, ec);
+    if (ec) {
+        std::error_code restoreEc;
+        writeNewestRingSlot(path, newest, options, restoreEc);
+        return;
+    }
+
+    if (options.deltas && newest != target) {
+        std::error_code realPathEc;
+        auto newestPath =
+            resolvePath(slotPath(path, newest), options, realPathEc);
+        if (!realPathEc) {
+            encodeAsDelta(newestPath, targetPath);
+        }
+    }
+}
+
+void
+rotate(const std::filesystem::path &path,
+       const std::filesystem::path &previousPath, Options options,
+       std::error_code &ec)
+{
+    switch (options.rotation) {
+        case Rotation::Shift:
+            rotateShift(path, previousPath, options, ec);
+            break;
+        case Rotation::Ring:
+            rotateRing(path, previousPath, options, ec);
+            break;
+    }
+}
+
+}  // namespace
+
+void
+saveWithBackup(const std::filesystem::path &path, Options options,
+               const std::function<void(const std::filesystem::path &,
+                                        std::error_code &ec)> &doWrite,
+               std::error_code &ec)
+{
+    auto realPath = resolvePath(path, options, ec);
+    if (ec) {
+        return;
+    }
+
+    auto tmpPath = writeTemporary(path, options, doWrite, ec);
     if (ec) {
         return;
     }
 
     if (options.enabled) {
-        std::filesystem::path firstBkpPath(bkpPath);
-        firstBkpPath += "-" + std::to_string(1);
+        rotate(path, realPath, options, ec);
+    }
+
+    detail::renameFile(tmpPath, realPath, ec);
+    if (ec) {
+        return;
+    }
+
+    syncParentDirectory(realPath, options, ec);
+}
+
+DeferredRotation
+saveWithDeferredBackup(
+    const std::filesystem::path &path, Options options,
+    const std::function<void(const std::filesystem::path &,
+                             std::error_code &ec)> &doWrite,
+    std::error_code &ec)
+{
+    auto realPath = resolvePath(path, options, ec);
+    if (ec) {
+        return {};
+    }
+
+    auto tmpPath = writeTemporary(path, options, doWrite, ec);
+    if (ec) {
+        return {};
+    }
 
-        if (options.numSlots > 1) {
-            std::filesystem::path topBkpPath(bkpPath);
-            topBkpPath += "-" + std::to_string(options.numSlots);
-            topBkpPath = detail::RealPath(topBkpPath, ec);
+    if (options.enabled && options.numSlots > 0) {
+        if (detail::exchangeFiles(tmpPath, realPath, ec)) {
+            syncParentDirectory(realPath, options, ec);
             if (ec) {
-                return;
+                return {};
             }
-            // Remove top slot backup
-            std::filesystem::remove(topBkpPath, ec);
-
-            // Shift backups one slot up
-            for (uint8_t slotIndex = options.numSlots - 1; slotIndex >= 1;
-                 --slotIndex) {
-                std::filesystem::path p1(bkpPath);
-                p1 += "-" + std::to_string(slotIndex);
-                p1 = detail::RealPath(p1, ec);
-                if (ec) {
-                    return;
-                }
-                std::filesystem::path p2(bkpPath);
-                p2 += "-" + std::to_string(slotIndex + 1);
-                p2 = detail::RealPath(p2, ec);
+
+            // The temporary file now holds the previous save
+            return [path, realPath, tmpPath, options](std::error_code &ec) {
+                rotate(path, tmpPath, options, ec);
                 if (ec) {
                     return;
                 }
-                detail::renameFile(p1, p2, ec);
-            }
+
+                syncParentDirectory(realPath, options, ec);
+            };
         }
 
-        // Move current save to first backup slot
-        detail::renameFile(realPath, firstBkpPath, ec);
+        if (ec != std::errc::no_such_file_or_directory) {
+            // Swapping is not supported here, rotate right away
+            ec.clear();
+            rotate(path, realPath, options, ec);
+        }
     }
 
+    // Either there's no previous save to back up, or it was already moved
     detail::renameFile(tmpPath, realPath, ec);
+    if (ec) {
+        return {};
+    }
+
+    syncParentDirectory(realPath, options, ec);
+
+    return {};
+}
+
+std::vector<std::filesystem::path>
+listBackups(const std::filesystem::path &path, Options options)
+{
+    std::vector<std::filesystem::path> backups;
+
+    if (options.numSlots == 0) {
+        return backups;
+    }
+
+    std::uint8_t newest = 1;
+    if (options.rotation == Rotation::Ring) {
+        newest = readNewestRingSlot(path, options.numSlots);
+    }
+
+    for (std::uint8_t i = 0; i < options.numSlots; ++i) {
+        // Older backups follow in ascending order, wrapping around
+        auto slotIndex =
+            static_cast<std::uint8_t>((newest - 1 + i) % options.numSlots + 1);
+        auto p = slotPath(path, slotIndex);
+
+        std::error_code ec;
+        if (std::filesystem::exists(p, ec)) {
+            backups.push_back(std::move(p));
+        }
+    }
+
+    return backups;
+}
+
+std::string
+restoreBackup(const std::filesystem::path &path, Options options,
+              std::size_t age, std::error_code &ec)
+{
+    auto backups = listBackups(path, options);
+    if (age < 1 || age > backups.size()) {
+        ec = std::make_error_code(std::errc::no_such_file_or_directory);
+        return {};
+    }
+
+    // Walk from the newest backup (always a full copy) to the requested one,
+    // applying deltas on the way
+    std::string contents;
+    std::string data;
+    for (std::size_t i = 0; i < age; ++i) {
+        if (!readFile(backups[i], data)) {
+            ec = std::make_error_code(std::errc::io_error);
+            return {};
+        }
+
+        if (!detail::isDelta(data)) {
+            contents.swap(data);
+            continue;
+        }
+
+        std::string older;
+        if (i == 0 || !detail::applyDelta(contents, data, older)) {
+            ec = std::make_error_code(std::errc::illegal_byte_sequence);
+            return {};
+        }
+        contents.swap(older);
+    }
+
+    ec = {};
+    return contents;
 }
 
 }  // namespace pajlada::Settings::Backup
@@ -0,0 +1,74 @@
+#include <pajlada/settings/changefeed.hpp>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace pajlada::Settings {
+
+ChangeFeed::ChangeFeed()
+{
+#ifdef __linux__
+    this->eventFd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+#endif
+}
+
+ChangeFeed::~ChangeFeed()
+{
+#ifdef __linux__
+    if (this->eventFd >= 0) {
+        ::close(this->eventFd);
+    }
+#endif
+}
+
+int
+ChangeFeed::fd() const
+{
+    return this->eventFd;
+}
+
+void
+ChangeFeed::push(Change change)
+{
+    this->queue.push(std::move(change));
+
+    if (this->signalled.exchange(true, std::memory_order_acq_rel)) {
+        // Already readable
+        return;
+    }
+
+#ifdef __linux__
+    if (this->eventFd >= 0) {
+        std::uint64_t one = 1;
+        // Can only fail if the counter overflows, which still leaves it
+        // readable
+        [[maybe_unused]] auto n = ::write(this->eventFd, &one, sizeof(one));
+    }
+#endif
+}
+
+std::vector<Change>
+ChangeFeed::drain()
+{
+#ifdef __linux__
+    if (this->eventFd >= 0) {
+        std::uint64_t count = 0;
+        [[maybe_unused]] auto n = ::read(this->eventFd, &count, sizeof(count));
+    }
+#endif
+
+    // Changes pushed from here on signal the eventfd again. The ones pushed
+    // before are taken below.
+    this->signalled.store(false, std::memory_order_release);
+
+    std::vector<Change> changes;
+    while (auto change = this->queue.pop()) {
+        changes.push_back(std::move(*change));
+    }
+
+    return changes;
+}
+
+}  // namespace pajlada::Settings
@@ -0,0 +1,78 @@
+#include <pajlada/settings/changelog.hpp>
+
+namespace pajlada::Settings {
+
+ChangeLog::ChangeLog(std::size_t capacity)
+    : slots(capacity)
+{
+}
+
+void
+ChangeLog::setCapacity(std::size_t capacity, std::uint64_t current)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->slots.clear();
+    this->slots.resize(capacity);
+    this->floor = current;
+}
+
+void
+ChangeLog::record(const Change &change)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    if (this->slots.empty() || change.sequence <= this->floor) {
+        return;
+    }
+
+    auto &slot = this->slots[change.sequence % this->slots.size()];
+
+    // Changes can be recorded slightly out of order by concurrent setters
+    if (slot.sequence < change.sequence) {
+        slot = change;
+    }
+}
+
+ChangesSince
+ChangeLog::since(std::uint64_t sequence, std::uint64_t current) const
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    ChangesSince result;
+    result.sequence = sequence;
+
+    if (sequence >= current) {
+        return result;
+    }
+
+    if (sequence < this->floor || this->slots.empty()) {
+        result.resyncNeeded = true;
+        result.sequence = current;
+        return result;
+    }
+
+    for (auto next = sequence + 1; next <= current; ++next) {
+        const auto &slot = this->slots[next % this->slots.size()];
+
+        if (slot.sequence > next) {
+            // Overwritten by a newer change, we've fallen behind
+            result.resyncNeeded = true;
+            result.changes.clear();
+            result.sequence = current;
+            return result;
+        }
+
+        if (slot.sequence < next) {
+            // Not recorded yet, pick it up next time
+            break;
+        }
+
+        result.changes.push_back(slot);
+        result.sequence = next;
+    }
+
+    return result;
+}
+
+}  // namespace pajlada::Settings
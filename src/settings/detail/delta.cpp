@@ -0,0 +1,243 @@
+#include <cstdint>
+#include <cstring>
+#include <pajlada/settings/detail/delta.hpp>
+#include <unordered_map>
+#include <vector>
+
+namespace pajlada::Settings::detail {
+
+namespace {
+
+constexpr std::string_view DELTA_MAGIC = "PSDELTA1";
+
+// Copies shorter than this are cheaper to store as inserted bytes
+constexpr std::size_t MIN_COPY_LENGTH = 32;
+
+// The number of candidate positions looked at for each line
+constexpr std::size_t MAX_CANDIDATES = 8;
+
+enum Op : char {
+    Copy = 'C',
+    Insert = 'I',
+};
+
+void
+putU64(std::string &out, std::uint64_t v)
+{
+    char bytes[8];
+    std::memcpy(bytes, &v, sizeof(v));
+    out.append(bytes, sizeof(bytes));
+}
+
+bool
+getU64(std::string_view in, std::size_t &pos, std::uint64_t &v)
+{
+    if (in.size() - pos < sizeof(v)) {
+        return false;
+    }
+    std::memcpy(&v, in.data() + pos, sizeof(v));
+    pos += sizeof(v);
+    return true;
+}
+
+std::vector<std::string_view>
+splitLines(std::string_view data)
+{
+    std::vector<std::string_view> lines;
+
+    std::size_t start = 0;
+    while (start < data.size()) {
+        auto end = data.find('\n', start);
+        end = end == std::string_view::npos ? data.size() : end + 1;
+        lines.push_back(data.substr(start, end - start));
+        start = end;
+    }
+
+    return lines;
+}
+
+class DeltaWriter
+{
+public:
+    explicit DeltaWriter(std::string &_out)
+        : out(_out)
+    {
+    }
+
+    void
+    copy(std::size_t offset, std::size_t length)
+    {
+        if (length < MIN_COPY_LENGTH) {
+            this->pendingInsert.append(this->base.substr(offset, length));
+            return;
+        }
+
+        this->flushInsert();
+
+        this->out += Op::Copy;
+        putU64(this->out, offset);
+        putU64(this->out, length);
+    }
+
+    void
+    insert(std::string_view data)
+    {
+        this->pendingInsert.append(data);
+    }
+
+    void
+    flushInsert()
+    {
+        if (this->pendingInsert.empty()) {
+            return;
+        }
+
+        this->out += Op::Insert;
+        putU64(this->out, this->pendingInsert.size());
+        this->out += this->pendingInsert;
+        this->pendingInsert.clear();
+    }
+
+    std::string_view base;
+
+private:
+    std::string &out;
+    std::string pendingInsert;
+};
+
+}  // namespace
+
+std::string
+makeDelta(std::string_view base, std::string_view target)
+{
+    std::string out(DELTA_MAGIC);
+    putU64(out, target.size());
+
+    auto baseLines = splitLines(base);
+    auto targetLines = splitLines(target);
+
+    std::vector<std::size_t> baseOffsets;
+    baseOffsets.reserve(baseLines.size() + 1);
+    std::size_t offset = 0;
+    for (const auto &line : baseLines) {
+        baseOffsets.push_back(offset);
+        offset += line.size();
+    }
+    baseOffsets.push_back(offset);
+
+    std::unordered_map<std::string_view, std::vector<std::size_t>> positions;
+    for (std::size_t i = 0; i < baseLines.size(); ++i) {
+        auto &candidates = positions[baseLines[i]];
+        if (candidates.size() < MAX_CANDIDATES) {
+            candidates.push_back(i);
+        }
+    }
+
+    DeltaWriter writer(out);
+    writer.base = base;
+
+    // Length (in lines) of the run of equal lines starting at `b` and `t`
+    auto runLength = [&](std::size_t b, std::size_t t) {
+        std::size_t n = 0;
+        while (b + n < baseLines.size() && t + n < targetLines.size() &&
+               baseLines[b + n] == targetLines[t + n]) {
+            ++n;
+        }
+        return n;
+    };
+
+    // The base line following the previous copy is the most likely match
+    std::size_t expected = 0;
+
+    std::size_t t = 0;
+    while (t < targetLines.size()) {
+        std::size_t bestStart = 0;
+        std::size_t bestLength = 0;
+
+        if (expected < baseLines.size()) {
+            bestLength = runLength(expected, t);
+            bestStart = expected;
+        }
+
+        if (bestLength == 0) {
+            auto it = positions.find(targetLines[t]);
+            if (it != positions.end()) {
+                for (auto candidate : it->second) {
+                    auto length = runLength(candidate, t);
+                    if (length > bestLength) {
+                        bestStart = candidate;
+                        bestLength = length;
+                    }
+                }
+            }
+        }
+
+        if (bestLength == 0) {
+            writer.insert(targetLines[t]);
+            ++t;
+            continue;
+        }
+
+        writer.copy(baseOffsets[bestStart],
+                    baseOffsets[bestStart + bestLength] -
+                        baseOffsets[bestStart]);
+        t += bestLength;
+        expected = bestStart + bestLength;
+    }
+
+    writer.flushInsert();
+
+    return out;
+}
+
+bool
+isDelta(std::string_view data)
+{
+    return data.substr(0, DELTA_MAGIC.size()) == DELTA_MAGIC;
+}
+
+bool
+applyDelta(std::string_view base, std::string_view delta,
+           std::string &target)
+{
+    if (!isDelta(delta)) {
+        return false;
+    }
+
+    std::size_t pos = DELTA_MAGIC.size();
+
+    std::uint64_t targetSize = 0;
+    if (!getU64(delta, pos, targetSize)) {
+        return false;
+    }
+
+    target.clear();
+    target.reserve(targetSize);
+
+    while (pos < delta.size()) {
+        auto op = delta[pos++];
+
+        if (op == Op::Copy) {
+            std::uint64_t offset = 0;
+            std::uint64_t length = 0;
+            if (!getU64(delta, pos, offset) || !getU64(delta, pos, length) ||
+                offset > base.size() || length > base.size() - offset) {
+                return false;
+            }
+            target.append(base.substr(offset, length));
+        } else if (op == Op::Insert) {
+            std::uint64_t length = 0;
+            if (!getU64(delta, pos, length) || length > delta.size() - pos) {
+                return false;
+            }
+            target.append(delta.substr(pos, length));
+            pos += length;
+        } else {
+            return false;
+        }
+    }
+
+    return target.size() == targetSize;
+}
+
+}  // namespace pajlada::Settings::detail
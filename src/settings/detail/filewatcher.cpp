@@ -0,0 +1,206 @@
+#include <pajlada/settings/detail/filewatcher.hpp>
+#include <pajlada/settings/detail/realpath.hpp>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+namespace pajlada::Settings::detail {
+
+FileWatcher::FileWatcher(std::filesystem::path _path,
+                         std::chrono::milliseconds _debounce,
+                         std::function<void()> _onChanged)
+    : debounce(_debounce)
+    , onChanged(std::move(_onChanged))
+{
+    std::error_code ec;
+    this->path = RealPath(_path, ec);
+    if (ec) {
+        return;
+    }
+
+#ifdef __linux__
+    auto directory = this->path.parent_path();
+    if (directory.empty()) {
+        directory = ".";
+    }
+
+    this->inotifyFd = ::inotify_init1(IN_CLOEXEC);
+    if (this->inotifyFd < 0) {
+        return;
+    }
+
+    // Saves done through a temporary file show up as IN_MOVED_TO, in-place
+    // writes as IN_CLOSE_WRITE
+    if (::inotify_add_watch(this->inotifyFd, directory.c_str(),
+                            IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        ::close(this->inotifyFd);
+        this->inotifyFd = -1;
+        return;
+    }
+
+    this->stopFd = ::eventfd(0, EFD_CLOEXEC);
+    if (this->stopFd < 0) {
+        ::close(this->inotifyFd);
+        this->inotifyFd = -1;
+        return;
+    }
+
+    this->known = this->fingerprint();
+
+    this->thread = std::thread([this] {
+        this->run();
+    });
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+    if (this->thread.joinable()) {
+        std::uint64_t one = 1;
+        (void)::write(this->stopFd, &one, sizeof(one));
+        this->thread.join();
+    }
+
+    if (this->stopFd >= 0) {
+        ::close(this->stopFd);
+    }
+    if (this->inotifyFd >= 0) {
+        ::close(this->inotifyFd);
+    }
+#endif
+}
+
+bool
+FileWatcher::isRunning() const
+{
+    return this->thread.joinable();
+}
+
+void
+FileWatcher::beginOwnWrite()
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    ++this->ownWrites;
+}
+
+void
+FileWatcher::endOwnWrite(bool written)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    if (this->ownWrites > 0) {
+        --this->ownWrites;
+    }
+    if (written) {
+        this->known = this->fingerprint();
+    }
+}
+
+FileWatcher::Fingerprint
+FileWatcher::fingerprint() const
+{
+    Fingerprint result;
+
+    // Identity (inode, size, mtime) can't tell two writes within the same
+    // timestamp apart, the contents can
+    std::ifstream fh(this->path, std::ios::binary | std::ios::in);
+    if (!fh) {
+        return result;
+    }
+
+    std::string contents{std::istreambuf_iterator<char>(fh),
+                         std::istreambuf_iterator<char>()};
+
+    result.exists = true;
+    result.size = contents.size();
+    result.hash = std::hash<std::string_view>{}(contents);
+
+    return result;
+}
+
+void
+FileWatcher::run()
+{
+#ifdef __linux__
+    const auto fileName = this->path.filename().native();
+
+    pollfd fds[2] = {
+        {.fd = this->inotifyFd, .events = POLLIN, .revents = 0},
+        {.fd = this->stopFd, .events = POLLIN, .revents = 0},
+    };
+
+    alignas(inotify_event) char buffer[4096];
+
+    bool pending = false;
+
+    while (true) {
+        int timeout = pending ? static_cast<int>(this->debounce.count()) : -1;
+        int n = ::poll(fds, 2, timeout);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+
+        if ((fds[1].revents & POLLIN) != 0) {
+            return;
+        }
+
+        if (n == 0) {
+            // The burst of events is over
+            pending = false;
+
+            {
+                // Read under the lock so a save can't finish in between
+                std::lock_guard<std::mutex> lock(this->mutex);
+
+                if (this->ownWrites > 0) {
+                    // Our own save is still being written, look again once
+                    // it's done
+                    pending = true;
+                    continue;
+                }
+
+                auto current = this->fingerprint();
+                if (current == this->known) {
+                    // e.g. our own save
+                    continue;
+                }
+                this->known = current;
+            }
+
+            this->onChanged();
+            continue;
+        }
+
+        auto length = ::read(this->inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            continue;
+        }
+
+        for (const char *it = buffer; it < buffer + length;) {
+            const auto *event = reinterpret_cast<const inotify_event *>(it);
+            if (event->len > 0 && fileName == event->name) {
+                pending = true;
+            }
+            it += sizeof(inotify_event) + event->len;
+        }
+    }
+#endif
+}
+
+}  // namespace pajlada::Settings::detail
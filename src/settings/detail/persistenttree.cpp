@@ -0,0 +1,231 @@
+#include <pajlada/settings/detail/persistenttree.hpp>
+#include <pajlada/settings/detail/pointer.hpp>
+
+namespace pajlada::Settings::detail {
+
+namespace {
+
+// Copy of a value that needs no allocator (anything but strings & containers)
+rapidjson::Value
+copyScalar(const rapidjson::Value &value)
+{
+    if (value.IsBool()) {
+        return rapidjson::Value(value.GetBool());
+    }
+
+    if (value.IsNumber()) {
+        if (value.IsDouble()) {
+            return rapidjson::Value(value.GetDouble());
+        }
+        if (value.IsInt()) {
+            return rapidjson::Value(value.GetInt());
+        }
+        if (value.IsUint()) {
+            return rapidjson::Value(value.GetUint());
+        }
+        if (value.IsInt64()) {
+            return rapidjson::Value(value.GetInt64());
+        }
+        return rapidjson::Value(value.GetUint64());
+    }
+
+    return rapidjson::Value();
+}
+
+// Parses an array index token, returns false if it isn't one
+bool
+parseIndex(const std::string &token, rapidjson::SizeType &index)
+{
+    if (token.empty() || token.size() > 9 ||
+        token.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+
+    index = static_cast<rapidjson::SizeType>(std::stoul(token));
+    return true;
+}
+
+PersistentNode::Ptr
+update(const PersistentNode::Ptr &old, const rapidjson::Value &value,
+       const std::vector<std::string> &tokens, std::size_t depth)
+{
+    if (depth == tokens.size() || old == nullptr ||
+        old->type != value.GetType()) {
+        return makePersistent(value);
+    }
+
+    const auto &token = tokens[depth];
+
+    if (value.IsObject()) {
+        auto node = std::make_shared<PersistentNode>();
+        node->type = rapidjson::kObjectType;
+        node->members = old->members;
+
+        auto name = unescapePointerToken(token);
+        auto member = node->members.begin();
+        while (member != node->members.end() && member->first != name) {
+            ++member;
+        }
+
+        auto it = value.FindMember(
+            rapidjson::Value(rapidjson::StringRef(name.c_str(), name.size())));
+        if (it == value.MemberEnd()) {
+            // Removed
+            if (member != node->members.end()) {
+                node->members.erase(member);
+            }
+            return node;
+        }
+
+        if (member == node->members.end()) {
+            node->members.emplace_back(
+                name, update(nullptr, it->value, tokens, depth + 1));
+        } else {
+            member->second = update(member->second, it->value, tokens,
+                                    depth + 1);
+        }
+
+        return node;
+    }
+
+    if (value.IsArray()) {
+        if (old->elements.size() != value.Size()) {
+            // Elements were added or removed
+            return makePersistent(value);
+        }
+
+        rapidjson::SizeType index = 0;
+        if (!parseIndex(token, index) || index >= value.Size()) {
+            return old;
+        }
+
+        auto node = std::make_shared<PersistentNode>();
+        node->type = rapidjson::kArrayType;
+        node->elements = old->elements;
+        node->elements[index] = update(old->elements[index],
+                                       *(value.Begin() + index), tokens,
+                                       depth + 1);
+
+        return node;
+    }
+
+    // `path` goes through a scalar, so it doesn't exist
+    return old;
+}
+
+}  // namespace
+
+PersistentNode::Ptr
+makePersistent(const rapidjson::Value &value)
+{
+    auto node = std::make_shared<PersistentNode>();
+    node->type = value.GetType();
+
+    if (value.IsObject()) {
+        node->members.reserve(value.MemberCount());
+        for (auto it = value.MemberBegin(); it != value.MemberEnd(); ++it) {
+            node->members.emplace_back(
+                std::string(it->name.GetString(), it->name.GetStringLength()),
+                makePersistent(it->value));
+        }
+    } else if (value.IsArray()) {
+        node->elements.reserve(value.Size());
+        for (auto it = value.Begin(); it != value.End(); ++it) {
+            node->elements.push_back(makePersistent(*it));
+        }
+    } else if (value.IsString()) {
+        node->text.assign(value.GetString(), value.GetStringLength());
+    } else {
+        node->scalar = copyScalar(value);
+    }
+
+    return node;
+}
+
+PersistentNode::Ptr
+updatePersistent(const PersistentNode::Ptr &root,
+                 const rapidjson::Value &document, const std::string &path)
+{
+    return update(root, document, splitPointer(path), 0);
+}
+
+const PersistentNode *
+findPersistent(const PersistentNode::Ptr &root, const std::string &path)
+{
+    const auto *node = root.get();
+
+    for (const auto &token : splitPointer(path)) {
+        if (node == nullptr) {
+            return nullptr;
+        }
+
+        if (node->type == rapidjson::kObjectType) {
+            auto name = unescapePointerToken(token);
+            const PersistentNode *next = nullptr;
+            for (const auto &[memberName, member] : node->members) {
+                if (memberName == name) {
+                    next = member.get();
+                    break;
+                }
+            }
+            node = next;
+        } else if (node->type == rapidjson::kArrayType) {
+            rapidjson::SizeType index = 0;
+            if (!parseIndex(token, index) || index >= node->elements.size()) {
+                return nullptr;
+            }
+            node = node->elements[index].get();
+        } else {
+            return nullptr;
+        }
+    }
+
+    return node;
+}
+
+void
+copyPersistent(const PersistentNode &node, rapidjson::Value &out,
+               rapidjson::Document::AllocatorType &allocator)
+{
+    switch (node.type) {
+        case rapidjson::kObjectType: {
+            out.SetObject();
+            for (const auto &[name, member] : node.members) {
+                rapidjson::Value key(name.c_str(),
+                                     static_cast<rapidjson::SizeType>(
+                                         name.size()),
+                                     allocator);
+                rapidjson::Value value;
+                copyPersistent(*member, value, allocator);
+                out.AddMember(key, value, allocator);
+            }
+        }
+        break;
+
+        case rapidjson::kArrayType: {
+            out.SetArray();
+            out.Reserve(static_cast<rapidjson::SizeType>(node.elements.size()),
+                        allocator);
+            for (const auto &element : node.elements) {
+                rapidjson::Value value;
+                copyPersistent(*element, value, allocator);
+                out.PushBack(value, allocator);
+            }
+        }
+        break;
+
+        case rapidjson::kStringType: {
+            out.SetString(node.text.c_str(),
+                          static_cast<rapidjson::SizeType>(node.text.size()),
+                          allocator);
+        }
+        break;
+
+        default: {
+            out = copyScalar(node.scalar);
+        }
+        break;
+    }
+}
+
+}  // namespace pajlada::Settings::detail
@@ -0,0 +1,92 @@
+#include <pajlada/settings/detail/pointer.hpp>
+
+#include <algorithm>
+
+namespace pajlada::Settings::detail {
+
+bool
+isSameOrChild(std::string_view path, std::string_view parent)
+{
+    if (path.substr(0, parent.length()) != parent) {
+        return false;
+    }
+
+    return path.length() == parent.length() || path[parent.length()] == '/';
+}
+
+bool
+pointerLess(std::string_view a, std::string_view b)
+{
+    // Tokens are escaped, so comparing them one by one is the same as
+    // comparing the whole pointers with '/' sorting before any other byte
+    auto rank = [](char c) {
+        return c == '/' ? 0 : static_cast<unsigned char>(c) + 1;
+    };
+
+    auto length = std::min(a.length(), b.length());
+    for (std::string_view::size_type i = 0; i < length; ++i) {
+        if (a[i] != b[i]) {
+            return rank(a[i]) < rank(b[i]);
+        }
+    }
+
+    return a.length() < b.length();
+}
+
+void
+appendPointerToken(std::string &path, std::string_view token)
+{
+    path += '/';
+    for (auto c : token) {
+        switch (c) {
+            case '~':
+                path += "~0";
+                break;
+            case '/':
+                path += "~1";
+                break;
+            default:
+                path += c;
+                break;
+        }
+    }
+}
+
+std::vector<std::string>
+splitPointer(const std::string &path)
+{
+    std::vector<std::string> tokens;
+
+    std::string::size_type start = 1;
+    while (!path.empty() && start <= path.size()) {
+        auto end = path.find('/', start);
+        if (end == std::string::npos) {
+            end = path.size();
+        }
+
+        tokens.push_back(path.substr(start, end - start));
+        start = end + 1;
+    }
+
+    return tokens;
+}
+
+std::string
+unescapePointerToken(std::string_view token)
+{
+    std::string name;
+    name.reserve(token.size());
+
+    for (std::string_view::size_type i = 0; i < token.size(); ++i) {
+        if (token[i] == '~' && i + 1 < token.size()) {
+            name += token[i + 1] == '1' ? '/' : '~';
+            ++i;
+            continue;
+        }
+        name += token[i];
+    }
+
+    return name;
+}
+
+}  // namespace pajlada::Settings::detail
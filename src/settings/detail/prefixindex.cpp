@@ -0,0 +1,133 @@
+#include <pajlada/settings/detail/pointer.hpp>
+#include <pajlada/settings/detail/prefixindex.hpp>
+
+namespace pajlada::Settings::detail {
+
+namespace {
+
+// Looks up a single token in `value`, like a rapidjson::Pointer would
+const rapidjson::Value *
+child(const rapidjson::Value *value, const std::string &token)
+{
+    if (value == nullptr) {
+        return nullptr;
+    }
+
+    if (value->IsObject()) {
+        auto name = unescapePointerToken(token);
+        auto it = value->FindMember(
+            rapidjson::Value(rapidjson::StringRef(name.c_str(), name.size())));
+        if (it == value->MemberEnd()) {
+            return nullptr;
+        }
+        return &it->value;
+    }
+
+    if (value->IsArray()) {
+        if (token.empty() || token.size() > 9 ||
+            token.find_first_not_of("0123456789") != std::string::npos) {
+            return nullptr;
+        }
+
+        auto index = static_cast<rapidjson::SizeType>(std::stoul(token));
+        if (index >= value->Size()) {
+            return nullptr;
+        }
+        return &*(value->Begin() + index);
+    }
+
+    return nullptr;
+}
+
+}  // namespace
+
+Signals::Connection
+PrefixIndex::connect(const std::string &prefix,
+                     PrefixSignal::CallbackType callback)
+{
+    std::string path(prefix);
+    if (!path.empty() && path.back() == '/') {
+        path.pop_back();
+    }
+
+    std::shared_ptr<PrefixSignal> signal;
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        auto *node = &this->root;
+        for (const auto &token : splitPointer(path)) {
+            auto &next = node->children[token];
+            if (!next) {
+                next = std::make_unique<Node>();
+            }
+            node = next.get();
+        }
+
+        if (!node->signal) {
+            node->signal = std::make_shared<PrefixSignal>();
+        }
+        signal = node->signal;
+    }
+
+    return signal->connect(std::move(callback));
+}
+
+void
+PrefixIndex::notify(const std::string &path, const rapidjson::Value &value,
+                    const SignalArgs &args)
+{
+    std::vector<Target> targets;
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        const Node *node = &this->root;
+        if (node->signal) {
+            targets.push_back({node->signal, path, &value});
+        }
+
+        for (const auto &token : splitPointer(path)) {
+            auto it = node->children.find(token);
+            if (it == node->children.end()) {
+                node = nullptr;
+                break;
+            }
+
+            node = it->second.get();
+            if (node->signal) {
+                targets.push_back({node->signal, path, &value});
+            }
+        }
+
+        if (node != nullptr) {
+            collectChildren(*node, path, &value, targets);
+        }
+    }
+
+    const rapidjson::Value null;
+    for (const auto &target : targets) {
+        target.signal->invoke(target.path,
+                              target.value != nullptr ? *target.value : null,
+                              args);
+    }
+}
+
+void
+PrefixIndex::collectChildren(const Node &node, const std::string &path,
+                             const rapidjson::Value *value,
+                             std::vector<Target> &targets)
+{
+    for (const auto &[token, childNode] : node.children) {
+        auto childPath = path + "/" + token;
+        const auto *childValue = child(value, token);
+
+        if (childNode->signal) {
+            targets.push_back({childNode->signal, childPath, childValue});
+        }
+
+        collectChildren(*childNode, childPath, childValue, targets);
+    }
+}
+
+}  // namespace pajlada::Settings::detail
@@ -1,6 +1,7 @@
 #include <pajlada/settings/detail/realpath.hpp>
 #include <pajlada/settings/internal.hpp>
-#include <unordered_set>
+#include <algorithm>
+#include <vector>
 
 namespace pajlada::Settings::detail {
 
@@ -23,16 +24,18 @@ RealPath(const std::filesystem::path &_path, std::error_code &ec)
 
     const auto relativePath = path.parent_path();
 
-    std::unordered_set<std::filesystem::path::string_type> seenPaths;
+    // Symlink chains are short, a linear search beats hashing here
+    std::vector<std::filesystem::path::string_type> seenPaths;
 
     do {
-        auto pathString = path.native();
-        if (seenPaths.count(pathString) != 0) {
+        const auto &pathString = path.native();
+        if (std::find(seenPaths.begin(), seenPaths.end(), pathString) !=
+            seenPaths.end()) {
             ec = std::make_error_code(std::errc::too_many_symbolic_link_levels);
             return path;
         }
 
-        seenPaths.emplace(pathString);
+        seenPaths.push_back(pathString);
         auto symlinkResponse = std::filesystem::read_symlink(path, ec);
         if (!symlinkResponse.is_absolute()) {
             path = relativePath / symlinkResponse;
@@ -54,4 +57,38 @@ RealPath(const std::filesystem::path &_path, std::error_code &ec)
     return path;
 }
 
+std::filesystem::path
+RealPathCache::resolve(const std::filesystem::path &path, std::error_code &ec)
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        auto it = this->resolvedPaths.find(path.native());
+        if (it != this->resolvedPaths.end()) {
+            ec = {};
+            return it->second;
+        }
+    }
+
+    auto realPath = RealPath(path, ec);
+    if (ec) {
+        // Errors (e.g. symlink loops) are not cached, they might be fixed
+        return realPath;
+    }
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->resolvedPaths.emplace(path.native(), realPath);
+
+    return realPath;
+}
+
+void
+RealPathCache::clear()
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->resolvedPaths.clear();
+}
+
 }  // namespace pajlada::Settings::detail
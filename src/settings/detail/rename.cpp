@@ -5,6 +5,16 @@
 #include <Windows.h>
 #endif
 
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef RENAME_EXCHANGE
+#define RENAME_EXCHANGE (1 << 1)
+#endif
+#endif
+
 namespace pajlada::Settings::detail {
 
 void
@@ -25,4 +35,26 @@ renameFile(const std::filesystem::path &from, const std::filesystem::path &to,
 #endif
 }
 
+bool
+exchangeFiles(const std::filesystem::path &a, const std::filesystem::path &b,
+              std::error_code &ec)
+{
+#if defined(__linux__) && defined(SYS_renameat2)
+    // Called through syscall since glibc only has a wrapper since 2.28
+    if (::syscall(SYS_renameat2, AT_FDCWD, a.c_str(), AT_FDCWD, b.c_str(),
+                  RENAME_EXCHANGE) == 0) {
+        ec = {0, std::system_category()};
+        return true;
+    }
+
+    ec = {errno, std::system_category()};
+    return false;
+#else
+    (void)a;
+    (void)b;
+    ec = std::make_error_code(std::errc::operation_not_supported);
+    return false;
+#endif
+}
+
 }  // namespace pajlada::Settings::detail
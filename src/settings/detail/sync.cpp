@@ -0,0 +1,80 @@
+#include <pajlada/settings/detail/sync.hpp>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace pajlada::Settings::detail {
+
+void
+syncFile(const std::filesystem::path &path, std::error_code &ec)
+{
+#ifdef _WIN32
+    HANDLE handle =
+        CreateFileW(path.c_str(), GENERIC_WRITE,
+                    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                    nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        ec = {static_cast<int>(GetLastError()), std::system_category()};
+        return;
+    }
+
+    if (FlushFileBuffers(handle) == TRUE) {
+        ec = {0, std::system_category()};
+    } else {
+        ec = {static_cast<int>(GetLastError()), std::system_category()};
+    }
+
+    CloseHandle(handle);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        ec = {errno, std::system_category()};
+        return;
+    }
+
+#ifdef __APPLE__
+    int res = ::fsync(fd);
+#else
+    int res = ::fdatasync(fd);
+#endif
+    if (res == 0) {
+        ec = {0, std::system_category()};
+    } else {
+        ec = {errno, std::system_category()};
+    }
+
+    ::close(fd);
+#endif
+}
+
+void
+syncDirectory(const std::filesystem::path &directory, std::error_code &ec)
+{
+#ifdef _WIN32
+    (void)directory;
+    ec = {0, std::system_category()};
+#else
+    const auto &dir = directory.empty() ? std::filesystem::path(".")
+                                        : directory;
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        ec = {errno, std::system_category()};
+        return;
+    }
+
+    if (::fsync(fd) == 0) {
+        ec = {0, std::system_category()};
+    } else {
+        ec = {errno, std::system_category()};
+    }
+
+    ::close(fd);
+#endif
+}
+
+}  // namespace pajlada::Settings::detail
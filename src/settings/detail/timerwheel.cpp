@@ -0,0 +1,114 @@
+#include <pajlada/settings/detail/timerwheel.hpp>
+
+namespace pajlada::Settings::detail {
+
+TimerWheel::TimerWheel(std::chrono::milliseconds _tick, std::size_t numSlots)
+    : tick(_tick.count() > 0 ? _tick : std::chrono::milliseconds(1))
+    , slots(numSlots > 0 ? numSlots : 1)
+{
+    this->thread = std::thread([this] {
+        this->run();
+    });
+}
+
+TimerWheel::~TimerWheel()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        this->stopping = true;
+    }
+
+    this->condition.notify_all();
+    this->thread.join();
+}
+
+TimerWheel &
+TimerWheel::instance()
+{
+    static TimerWheel wheel;
+
+    return wheel;
+}
+
+void
+TimerWheel::schedule(std::chrono::milliseconds delay, Callback callback)
+{
+    auto ticks = static_cast<std::uint64_t>(
+        (delay.count() + this->tick.count() - 1) / this->tick.count());
+    if (ticks == 0) {
+        ticks = 1;
+    }
+
+    bool wasIdle = false;
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        auto numSlots = this->slots.size();
+        auto slot = (this->current + ticks) % numSlots;
+        this->slots[slot].push_back({(ticks - 1) / numSlots,
+                                     std::move(callback)});
+
+        wasIdle = this->numEntries++ == 0;
+    }
+
+    if (wasIdle) {
+        this->condition.notify_one();
+    }
+}
+
+void
+TimerWheel::run()
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    while (true) {
+        this->condition.wait(lock, [this] {
+            return this->stopping || this->numEntries > 0;
+        });
+        if (this->stopping) {
+            return;
+        }
+
+        // Ticks are counted from when the first timer came in
+        auto nextTick = std::chrono::steady_clock::now() + this->tick;
+
+        while (this->numEntries > 0) {
+            if (this->condition.wait_until(lock, nextTick, [this] {
+                    return this->stopping;
+                })) {
+                return;
+            }
+
+            // Catch up on ticks missed while callbacks were running
+            std::vector<Callback> due;
+            auto now = std::chrono::steady_clock::now();
+            while (nextTick <= now) {
+                nextTick += this->tick;
+                this->current = (this->current + 1) % this->slots.size();
+
+                auto &slot = this->slots[this->current];
+                for (auto it = slot.begin(); it != slot.end();) {
+                    if (it->rounds > 0) {
+                        --it->rounds;
+                        ++it;
+                        continue;
+                    }
+
+                    due.push_back(std::move(it->callback));
+                    it = slot.erase(it);
+                }
+            }
+            this->numEntries -= due.size();
+
+            lock.unlock();
+            for (auto &callback : due) {
+                callback();
+            }
+            lock.lock();
+        }
+    }
+}
+
+}  // namespace pajlada::Settings::detail
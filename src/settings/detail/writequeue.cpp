@@ -0,0 +1,114 @@
+#include <pajlada/settings/detail/writequeue.hpp>
+
+namespace pajlada::Settings::detail {
+
+WriteQueue::WriteQueue(ApplyBatch _apply)
+    : apply(std::move(_apply))
+{
+    this->thread = std::thread([this] {
+        this->run();
+    });
+}
+
+WriteQueue::~WriteQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        this->stopping = true;
+    }
+
+    this->condition.notify_one();
+    this->thread.join();
+}
+
+void
+WriteQueue::push(Write write)
+{
+    this->enqueue(Item{std::move(write), nullptr});
+}
+
+void
+WriteQueue::flush()
+{
+    if (std::this_thread::get_id() == this->thread.get_id()) {
+        return;
+    }
+
+    std::promise<void> barrier;
+    auto applied = barrier.get_future();
+
+    Item item;
+    item.barrier = &barrier;
+    this->enqueue(std::move(item));
+
+    applied.wait();
+}
+
+void
+WriteQueue::enqueue(Item item)
+{
+    this->queue.push(std::move(item));
+
+    if (this->pending.fetch_add(1, std::memory_order_acq_rel) == 0) {
+        // The apply thread might be asleep
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        this->condition.notify_one();
+    }
+}
+
+void
+WriteQueue::run()
+{
+    std::vector<Write> batch;
+    std::vector<std::promise<void> *> barriers;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+
+            this->condition.wait(lock, [this] {
+                return this->stopping ||
+                       this->pending.load(std::memory_order_acquire) > 0;
+            });
+
+            if (this->stopping &&
+                this->pending.load(std::memory_order_acquire) == 0) {
+                return;
+            }
+        }
+
+        std::size_t taken = 0;
+        auto available = this->pending.load(std::memory_order_acquire);
+        while (taken < available && batch.size() < MAX_BATCH) {
+            auto item = this->queue.pop();
+            if (!item) {
+                // A push is halfway done
+                std::this_thread::yield();
+                continue;
+            }
+
+            ++taken;
+            if (item->barrier != nullptr) {
+                barriers.push_back(item->barrier);
+            } else {
+                batch.push_back(std::move(item->write));
+            }
+        }
+
+        if (!batch.empty()) {
+            this->apply(batch);
+            batch.clear();
+        }
+
+        for (auto *barrier : barriers) {
+            barrier->set_value();
+        }
+        barriers.clear();
+
+        this->pending.fetch_sub(taken, std::memory_order_acq_rel);
+    }
+}
+
+}  // namespace pajlada::Settings::detail
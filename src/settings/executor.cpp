@@ -0,0 +1,80 @@
+#include <pajlada/settings/executor.hpp>
+
+namespace pajlada::Settings {
+
+ThreadPool::ThreadPool(std::size_t numThreads)
+{
+    if (numThreads == 0) {
+        numThreads = 1;
+    }
+
+    this->threads.reserve(numThreads);
+    for (std::size_t i = 0; i < numThreads; ++i) {
+        this->threads.emplace_back([this] {
+            this->run();
+        });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        this->stopping = true;
+    }
+
+    this->condition.notify_all();
+
+    for (auto &thread : this->threads) {
+        thread.join();
+    }
+}
+
+void
+ThreadPool::post(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        this->tasks.push_back(std::move(task));
+    }
+
+    this->condition.notify_one();
+}
+
+Executor
+ThreadPool::executor()
+{
+    return [this](std::function<void()> task) {
+        this->post(std::move(task));
+    };
+}
+
+void
+ThreadPool::run()
+{
+    while (true) {
+        std::function<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+
+            this->condition.wait(lock, [this] {
+                return this->stopping || !this->tasks.empty();
+            });
+
+            if (this->tasks.empty()) {
+                // Stopping, and everything has been run
+                return;
+            }
+
+            task = std::move(this->tasks.front());
+            this->tasks.pop_front();
+        }
+
+        task();
+    }
+}
+
+}  // namespace pajlada::Settings
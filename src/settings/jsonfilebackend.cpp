@@ -0,0 +1,469 @@
+#include <rapidjson/pointer.h>
+#include <rapidjson/prettywriter.h>
+
+#include <algorithm>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <pajlada/settings/detail/pointer.hpp>
+#include <pajlada/settings/detail/realpath.hpp>
+#include <pajlada/settings/jsonfilebackend.hpp>
+
+namespace pajlada::Settings {
+
+namespace {
+
+// Write `value` to `writer`, skipping any subtree whose JSON pointer is in
+// `excludedPointers`
+template <typename Writer>
+void
+writeExcluding(Writer &writer, const rapidjson::Value &value,
+               std::string &path,
+               const std::vector<std::string> &excludedPointers)
+{
+    bool hasExcludedChild = std::any_of(
+        excludedPointers.begin(), excludedPointers.end(),
+        [&path](const auto &pointer) {
+            return pointer.length() > path.length() &&
+                   detail::isSameOrChild(pointer, path);
+        });
+
+    if (!hasExcludedChild) {
+        value.Accept(writer);
+        return;
+    }
+
+    auto parentLength = path.length();
+
+    if (value.IsObject()) {
+        writer.StartObject();
+        for (auto it = value.MemberBegin(); it != value.MemberEnd(); ++it) {
+            detail::appendPointerToken(
+                path, {it->name.GetString(), it->name.GetStringLength()});
+            if (std::find(excludedPointers.begin(), excludedPointers.end(),
+                          path) == excludedPointers.end()) {
+                writer.Key(it->name.GetString(), it->name.GetStringLength());
+                writeExcluding(writer, it->value, path, excludedPointers);
+            }
+            path.resize(parentLength);
+        }
+        writer.EndObject();
+    } else if (value.IsArray()) {
+        writer.StartArray();
+        for (rapidjson::SizeType i = 0; i < value.Size(); ++i) {
+            path += '/' + std::to_string(i);
+            // Array elements can't be removed without shifting their
+            // siblings, so an excluded element is written as null
+            if (std::find(excludedPointers.begin(), excludedPointers.end(),
+                          path) == excludedPointers.end()) {
+                writeExcluding(writer, value[i], path, excludedPointers);
+            } else {
+                writer.Null();
+            }
+            path.resize(parentLength);
+        }
+        writer.EndArray();
+    } else {
+        value.Accept(writer);
+    }
+}
+
+LoadError
+readDocument(const std::filesystem::path &path, rapidjson::Document &document)
+{
+    // Open file
+    std::ifstream fh(path.c_str(), std::ios::binary | std::ios::in);
+    if (!fh) {
+        // Unable to open file at `path`
+        return LoadError::CannotOpenFile;
+    }
+
+    // Read size of file
+    std::error_code ec;
+    auto fileSize = std::filesystem::file_size(path, ec);
+    if (ec) {
+        return LoadError::FileHandleError;
+    }
+
+    if (fileSize == 0) {
+        // Nothing to load
+        return LoadError::NoError;
+    }
+
+    // Create std::vector of appropriate size
+    std::vector<char> fileBuffer;
+    fileBuffer.resize(fileSize);
+
+    // Read file data into buffer
+    fh.read(&fileBuffer[0], fileSize);
+
+    rapidjson::ParseResult ok = document.Parse(&fileBuffer[0], fileSize);
+
+    // Make sure the file parsed okay
+    if (!ok) {
+        return LoadError::JSONParseError;
+    }
+
+    return LoadError::NoError;
+}
+
+std::filesystem::path
+resolveShardPath(const std::filesystem::path &mainPath,
+                 const std::filesystem::path &shardPath)
+{
+    if (shardPath.is_absolute()) {
+        return shardPath;
+    }
+
+    return mainPath.parent_path() / shardPath;
+}
+
+bool
+writeTo(const std::filesystem::path &path, const rapidjson::Value &document,
+        const std::vector<std::string> &excludedPointers)
+{
+    std::ofstream fh(path.c_str(), std::ios::binary | std::ios::out);
+    if (!fh) {
+        // Unable to open file at `path`
+        return false;
+    }
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+    if (excludedPointers.empty()) {
+        document.Accept(writer);
+    } else {
+        std::string rootPath;
+        writeExcluding(writer, document, rootPath, excludedPointers);
+    }
+
+    fh.write(buffer.GetString(), buffer.GetSize());
+
+    return true;
+}
+
+bool
+writeShardTo(const std::filesystem::path &path,
+             const rapidjson::Value &document, const std::string &pointer)
+{
+    std::ofstream fh(path.c_str(), std::ios::binary | std::ios::out);
+    if (!fh) {
+        // Unable to open file at `path`
+        return false;
+    }
+
+    const auto *value = rapidjson::Pointer(pointer.c_str()).Get(document);
+    if (value == nullptr) {
+        // An empty shard file loads as "nothing"
+        return true;
+    }
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+    value->Accept(writer);
+
+    fh.write(buffer.GetString(), buffer.GetSize());
+
+    return true;
+}
+
+}  // namespace
+
+LoadError
+JsonFileBackend::load(const std::filesystem::path &_path,
+                      rapidjson::Document &document)
+{
+    std::error_code ec;
+
+    auto path = detail::RealPath(_path, ec);
+
+    if (ec) {
+        return LoadError::FileHandleError;
+    }
+
+    {
+        // A rotation might still be moving files around
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        this->waitForRotation();
+
+        // Loading is when symlinks are expected to have changed
+        this->realPaths.clear();
+    }
+
+    // Parse all shards in parallel while the main file is being parsed
+    struct LoadedShard {
+        std::string pointer;
+        std::future<LoadError> result;
+        rapidjson::Document document;
+    };
+
+    std::vector<std::unique_ptr<LoadedShard>> loadedShards;
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        for (const auto &shard : this->shards) {
+            auto shardPath = resolveShardPath(_path, shard.path);
+            auto &loaded = loadedShards.emplace_back(
+                std::make_unique<LoadedShard>());
+            loaded->pointer = shard.pointer;
+            loaded->result = std::async(
+                std::launch::async, [shardPath, doc = &loaded->document] {
+                    std::error_code ec;
+                    auto realPath = detail::RealPath(shardPath, ec);
+                    if (ec) {
+                        return LoadError::FileHandleError;
+                    }
+                    return readDocument(realPath, *doc);
+                });
+        }
+    }
+
+    // Merge newly parsed config file into our pre-existing document
+    // The pre-existing document might be empty, but we don't know that
+    auto error = readDocument(path, document);
+
+    LoadError shardError = LoadError::NoError;
+    for (auto &loaded : loadedShards) {
+        auto result = loaded->result.get();
+        if (result == LoadError::CannotOpenFile) {
+            // The shard has not been written yet, its values (if any) are
+            // still part of the main file
+            continue;
+        }
+
+        if (result != LoadError::NoError) {
+            shardError = result;
+            continue;
+        }
+
+        if (error != LoadError::NoError || loaded->document.IsNull()) {
+            continue;
+        }
+
+        // The shard document owns its allocator, so its value has to be
+        // copied into ours
+        rapidjson::Pointer(loaded->pointer.c_str())
+            .Set(document,
+                 static_cast<const rapidjson::Value &>(loaded->document));
+    }
+
+    if (error != LoadError::NoError) {
+        return error;
+    }
+
+    // This restricts config files a bit. They NEED to have an object root
+    if (!document.IsObject()) {
+        return LoadError::JSONParseError;
+    }
+
+    return shardError;
+}
+
+bool
+JsonFileBackend::persist(const std::filesystem::path &path,
+                         const rapidjson::Document &document,
+                         const PersistRequest &request)
+{
+    std::error_code ec;
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->waitForRotation();
+
+    auto options = this->backup;
+    options.realPathCache = &this->realPaths;
+
+    std::vector<Backup::DeferredRotation> rotations;
+
+    auto save = [this, &options, &rotations](const auto &filePath,
+                                             const auto &doWrite, auto &ec) {
+        if (!this->deferRotation) {
+            Backup::saveWithBackup(filePath, options, doWrite, ec);
+            return;
+        }
+
+        auto rotation =
+            Backup::saveWithDeferredBackup(filePath, options, doWrite, ec);
+        if (rotation) {
+            rotations.push_back(std::move(rotation));
+        }
+    };
+
+    std::vector<std::string> shardPointers;
+    shardPointers.reserve(this->shards.size());
+
+    for (const auto &shard : this->shards) {
+        shardPointers.push_back(shard.pointer);
+
+        auto shardPath = resolveShardPath(path, shard.path);
+
+        auto overlapsShard = [&shard](const auto &dirtyPath) {
+            return detail::isSameOrChild(dirtyPath, shard.pointer) ||
+                   detail::isSameOrChild(shard.pointer, dirtyPath);
+        };
+        bool dirty = request.full ||
+                     std::any_of(request.dirtyPaths.begin(),
+                                 request.dirtyPaths.end(), overlapsShard);
+        if (!dirty && std::filesystem::exists(shardPath, ec)) {
+            // Nothing inside of this shard has changed since it was last
+            // persisted
+            continue;
+        }
+
+        save(
+            shardPath,
+            [&document, &shard](const auto &tmpPath, auto &ec) {
+                if (!writeShardTo(tmpPath, document, shard.pointer)) {
+                    ec = std::make_error_code(std::errc::io_error);
+                }
+            },
+            ec);
+
+        if (ec) {
+            break;
+        }
+    }
+
+    // Values inside of shards aren't stored in the main file, so it's only
+    // rewritten (and its backups rotated) if something outside of them
+    // changed
+    auto insideShard = [&shardPointers](const auto &dirtyPath) {
+        return std::any_of(shardPointers.begin(), shardPointers.end(),
+                           [&dirtyPath](const auto &pointer) {
+                               return detail::isSameOrChild(dirtyPath, pointer);
+                           });
+    };
+    bool mainDirty = !ec && (request.full || shardPointers.empty() ||
+                             request.dirtyPaths.empty() ||
+                             !std::all_of(request.dirtyPaths.begin(),
+                                          request.dirtyPaths.end(),
+                                          insideShard) ||
+                             !std::filesystem::exists(path, ec));
+
+    if (!ec && mainDirty) {
+        save(
+            path,
+            [&document, &shardPointers](const auto &tmpPath, auto &ec) {
+                if (!writeTo(tmpPath, document, shardPointers)) {
+                    ec = std::make_error_code(std::errc::io_error);
+                }
+            },
+            ec);
+    }
+
+    if (!rotations.empty()) {
+        // The new files are in place, the previous saves only have to be
+        // moved into their backup slots
+        this->pendingRotation = std::async(
+            std::launch::async, [rotations = std::move(rotations)] {
+                std::error_code firstError;
+                for (const auto &rotation : rotations) {
+                    std::error_code ec;
+                    rotation(ec);
+                    if (ec && !firstError) {
+                        firstError = ec;
+                    }
+                }
+
+                return firstError;
+            });
+    }
+
+    return !ec;
+}
+
+bool
+JsonFileBackend::flush()
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    auto ec = this->waitForRotation();
+
+    // Reported once
+    this->rotationError.clear();
+
+    return !ec;
+}
+
+void
+JsonFileBackend::invalidate()
+{
+    this->realPaths.clear();
+}
+
+void
+JsonFileBackend::setBackupEnabled(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->backup.enabled = enabled;
+}
+
+void
+JsonFileBackend::setBackupSlots(uint8_t numSlots)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->backup.numSlots = numSlots;
+}
+
+void
+JsonFileBackend::setBackupRotation(Backup::Rotation rotation)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->backup.rotation = rotation;
+}
+
+void
+JsonFileBackend::setBackupDeltasEnabled(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->backup.deltas = enabled;
+}
+
+void
+JsonFileBackend::setDurability(Backup::Durability durability)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->backup.durability = durability;
+}
+
+void
+JsonFileBackend::setBackupDeferred(bool deferred)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->deferRotation = deferred;
+}
+
+void
+JsonFileBackend::addShard(const std::string &pointer,
+                          const std::filesystem::path &path)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->shards.push_back(Shard{
+        .pointer = pointer,
+        .path = path,
+    });
+}
+
+std::error_code
+JsonFileBackend::waitForRotation()
+{
+    if (this->pendingRotation.valid()) {
+        auto ec = this->pendingRotation.get();
+        if (ec && !this->rotationError) {
+            this->rotationError = ec;
+        }
+    }
+
+    return this->rotationError;
+}
+
+}  // namespace pajlada::Settings
@@ -0,0 +1,552 @@
+#include <rapidjson/pointer.h>
+#include <rapidjson/writer.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <pajlada/settings/detail/pointer.hpp>
+#include <pajlada/settings/detail/rename.hpp>
+#include <pajlada/settings/detail/sync.hpp>
+#include <pajlada/settings/logbackend.hpp>
+#include <unordered_map>
+#include <vector>
+
+namespace pajlada::Settings {
+
+namespace {
+
+constexpr char LOG_MAGIC[] = {'P', 'S', 'L', 'O', 'G', '0', '0', '1'};
+constexpr std::uint64_t LOG_HEADER_SIZE = sizeof(LOG_MAGIC);
+
+enum class RecordType : std::uint8_t {
+    Set = 1,
+    Erase = 2,
+};
+
+// checksum (4) + type (1) + path length (4) + value length (4)
+constexpr std::uint32_t RECORD_HEADER_SIZE = 13;
+
+constexpr std::array<std::uint32_t, 256> CRC_TABLE = [] {
+    std::array<std::uint32_t, 256> table{};
+    for (std::uint32_t i = 0; i < 256; ++i) {
+        std::uint32_t c = i;
+        for (int k = 0; k < 8; ++k) {
+            c = (c & 1) != 0 ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+        }
+        table[i] = c;
+    }
+    return table;
+}();
+
+std::uint32_t
+crc32(const char *data, std::size_t length)
+{
+    std::uint32_t crc = 0xFFFFFFFFU;
+    for (std::size_t i = 0; i < length; ++i) {
+        crc = CRC_TABLE[(crc ^ static_cast<std::uint8_t>(data[i])) & 0xFF] ^
+              (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFU;
+}
+
+void
+putU32(std::string &out, std::uint32_t v)
+{
+    char bytes[4];
+    std::memcpy(bytes, &v, sizeof(v));
+    out.append(bytes, sizeof(bytes));
+}
+
+std::uint32_t
+getU32(const char *in)
+{
+    std::uint32_t v;
+    std::memcpy(&v, in, sizeof(v));
+    return v;
+}
+
+// Append a record to `out`, returning its size
+std::uint32_t
+appendRecord(std::string &out, RecordType type, const std::string &path,
+             const rapidjson::Value *value)
+{
+    rapidjson::StringBuffer buffer;
+    if (value != nullptr) {
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+        value->Accept(writer);
+    }
+
+    auto start = out.size();
+
+    // Checksum placeholder
+    putU32(out, 0);
+    out += static_cast<char>(type);
+    putU32(out, static_cast<std::uint32_t>(path.size()));
+    putU32(out, static_cast<std::uint32_t>(buffer.GetSize()));
+    out += path;
+    out.append(buffer.GetString(), buffer.GetSize());
+
+    auto checksum = crc32(out.data() + start + 4, out.size() - start - 4);
+    std::memcpy(&out[start], &checksum, sizeof(checksum));
+
+    return static_cast<std::uint32_t>(out.size() - start);
+}
+
+bool
+appendToFile(const std::filesystem::path &path, const std::string &data,
+             bool sync = false)
+{
+    {
+        std::ofstream fh(path.c_str(),
+                         std::ios::binary | std::ios::out | std::ios::app);
+        if (!fh) {
+            return false;
+        }
+
+        fh.write(data.data(), static_cast<std::streamsize>(data.size()));
+        fh.flush();
+        if (!fh) {
+            return false;
+        }
+    }
+
+    if (sync) {
+        std::error_code ec;
+        detail::syncFile(path, ec);
+        return !ec;
+    }
+
+    return true;
+}
+
+// Move the fully written `tmpPath` over `path`, flushing both to disk as
+// requested by `durability`
+bool
+replaceFile(const std::filesystem::path &tmpPath,
+            const std::filesystem::path &path, Backup::Durability durability)
+{
+    std::error_code ec;
+
+    if (durability != Backup::Durability::None) {
+        detail::syncFile(tmpPath, ec);
+        if (ec) {
+            return false;
+        }
+    }
+
+    detail::renameFile(tmpPath, path, ec);
+    if (ec) {
+        return false;
+    }
+
+    if (durability == Backup::Durability::SyncFileAndDirectory) {
+        detail::syncDirectory(path.parent_path(), ec);
+        if (ec) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+}  // namespace
+
+LogBackend::~LogBackend()
+{
+    this->flush();
+}
+
+LoadError
+LogBackend::load(const std::filesystem::path &path,
+                 rapidjson::Document &document)
+{
+    this->flush();
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    std::ifstream fh(path.c_str(), std::ios::binary | std::ios::in);
+    if (!fh) {
+        return LoadError::CannotOpenFile;
+    }
+
+    std::error_code ec;
+    auto fileSize = std::filesystem::file_size(path, ec);
+    if (ec) {
+        return LoadError::FileHandleError;
+    }
+
+    if (fileSize == 0) {
+        // Nothing to load
+        return LoadError::NoError;
+    }
+
+    std::vector<char> buffer(fileSize);
+    if (!fh.read(buffer.data(), static_cast<std::streamsize>(fileSize))) {
+        return LoadError::FileReadError;
+    }
+
+    if (fileSize < LOG_HEADER_SIZE ||
+        std::memcmp(buffer.data(), LOG_MAGIC, sizeof(LOG_MAGIC)) != 0) {
+        return LoadError::JSONParseError;
+    }
+
+    this->logPath = path;
+    ++this->logGeneration;
+    this->index.clear();
+    this->liveSize = 0;
+
+    rapidjson::Document loaded(rapidjson::kObjectType);
+    rapidjson::Document value;
+
+    std::uint64_t offset = LOG_HEADER_SIZE;
+    while (offset + RECORD_HEADER_SIZE <= fileSize) {
+        const char *record = buffer.data() + offset;
+        auto checksum = getU32(record);
+        auto type = static_cast<RecordType>(record[4]);
+        auto pathLength = getU32(record + 5);
+        auto valueLength = getU32(record + 9);
+
+        std::uint64_t size = std::uint64_t(RECORD_HEADER_SIZE) + pathLength +
+                             valueLength;
+        if (offset + size > fileSize ||
+            crc32(record + 4, size - 4) != checksum) {
+            // Torn or corrupt write, everything after this is lost
+            break;
+        }
+
+        std::string recordPath(record + RECORD_HEADER_SIZE, pathLength);
+        const char *valueData = record + RECORD_HEADER_SIZE + pathLength;
+
+        if (type == RecordType::Set) {
+            if (!value.Parse(valueData, valueLength).HasParseError()) {
+                rapidjson::Pointer(recordPath.c_str())
+                    .Set(loaded, static_cast<const rapidjson::Value &>(value));
+            }
+        } else if (type == RecordType::Erase) {
+            rapidjson::Pointer(recordPath.c_str()).Erase(loaded);
+        } else {
+            break;
+        }
+
+        this->indexRecord(recordPath,
+                          Entry{offset, static_cast<std::uint32_t>(size)});
+        offset += size;
+    }
+
+    fh.close();
+
+    if (offset != fileSize) {
+        // Cut off the broken tail so new records are appended after the last
+        // good one
+        std::filesystem::resize_file(path, offset, ec);
+        if (ec) {
+            return LoadError::FileHandleError;
+        }
+    }
+
+    this->logSize = offset;
+
+    if (!loaded.IsObject()) {
+        return LoadError::JSONParseError;
+    }
+
+    document.Swap(loaded);
+
+    return LoadError::NoError;
+}
+
+bool
+LogBackend::persist(const std::filesystem::path &path,
+                    const rapidjson::Document &document,
+                    const PersistRequest &request)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    if (request.full || path != this->logPath) {
+        return this->rewrite(path, document);
+    }
+
+    if (request.dirtyPaths.empty()) {
+        return true;
+    }
+
+    std::string data;
+    std::vector<std::pair<const std::string *, Entry>> entries;
+    entries.reserve(request.dirtyPaths.size());
+
+    for (const auto &dirtyPath : request.dirtyPaths) {
+        const auto *value =
+            rapidjson::Pointer(dirtyPath.c_str()).Get(document);
+        auto offset = this->logSize + data.size();
+        auto size = appendRecord(
+            data, value != nullptr ? RecordType::Set : RecordType::Erase,
+            dirtyPath, value);
+        entries.emplace_back(&dirtyPath, Entry{offset, size});
+    }
+
+    if (!appendToFile(
+            path, data,
+            this->durability == Backup::Durability::SyncFileAndDirectory)) {
+        return false;
+    }
+
+    this->logSize += data.size();
+    for (const auto &[dirtyPath, entry] : entries) {
+        this->indexRecord(*dirtyPath, entry);
+    }
+
+    this->compactIfNeeded();
+
+    return true;
+}
+
+bool
+LogBackend::flush()
+{
+    std::future<bool> pending;
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        pending = std::move(this->compaction);
+    }
+
+    if (pending.valid()) {
+        return pending.get();
+    }
+
+    return true;
+}
+
+void
+LogBackend::setCompactionThreshold(std::uint64_t numBytes)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->compactionThreshold = numBytes;
+}
+
+void
+LogBackend::setDurability(Backup::Durability newDurability)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->durability = newDurability;
+}
+
+void
+LogBackend::indexRecord(const std::string &path, Entry entry)
+{
+    // A write to `path` shadows any earlier record for a value inside of it
+    auto childPrefix = path + '/';
+    auto it = this->index.lower_bound(childPrefix);
+    while (it != this->index.end() &&
+           it->first.compare(0, childPrefix.length(), childPrefix) == 0) {
+        this->liveSize -= it->second.size;
+        it = this->index.erase(it);
+    }
+
+    auto [existing, inserted] = this->index.try_emplace(path, entry);
+    if (!inserted) {
+        this->liveSize -= existing->second.size;
+        existing->second = entry;
+    }
+
+    this->liveSize += entry.size;
+}
+
+bool
+LogBackend::rewrite(const std::filesystem::path &path,
+                    const rapidjson::Document &document)
+{
+    std::string data(LOG_MAGIC, sizeof(LOG_MAGIC));
+
+    this->logPath.clear();
+    ++this->logGeneration;
+    this->index.clear();
+    this->liveSize = 0;
+
+    for (auto it = document.MemberBegin(); it != document.MemberEnd(); ++it) {
+        std::string memberPath;
+        detail::appendPointerToken(
+            memberPath, {it->name.GetString(), it->name.GetStringLength()});
+        auto offset = data.size();
+        auto size =
+            appendRecord(data, RecordType::Set, memberPath, &it->value);
+        this->indexRecord(memberPath, Entry{offset, size});
+    }
+
+    std::filesystem::path tmpPath(path);
+    tmpPath += ".tmp";
+
+    {
+        std::ofstream fh(tmpPath.c_str(),
+                         std::ios::binary | std::ios::out | std::ios::trunc);
+        if (!fh) {
+            return false;
+        }
+
+        fh.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!fh) {
+            return false;
+        }
+    }
+
+    if (!replaceFile(tmpPath, path, this->durability)) {
+        return false;
+    }
+
+    this->logPath = path;
+    this->logSize = data.size();
+
+    return true;
+}
+
+bool
+LogBackend::compact()
+{
+    // The live records as of now, copied without holding the lock
+    std::filesystem::path path;
+    std::uint64_t generation = 0;
+    std::uint64_t copiedSize = 0;
+    std::vector<Entry> live;
+    auto syncMode = Backup::Durability::None;
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        path = this->logPath;
+        generation = this->logGeneration;
+        copiedSize = this->logSize;
+        syncMode = this->durability;
+
+        live.reserve(this->index.size());
+        for (const auto &[recordPath, entry] : this->index) {
+            live.push_back(entry);
+        }
+    }
+
+    if (path.empty()) {
+        return false;
+    }
+
+    // Keep records in log order, since later records overlay earlier ones
+    std::sort(live.begin(), live.end(), [](const auto &lhs, const auto &rhs) {
+        return lhs.offset < rhs.offset;
+    });
+
+    std::ifstream in(path.c_str(), std::ios::binary | std::ios::in);
+    if (!in) {
+        return false;
+    }
+
+    std::string data(LOG_MAGIC, sizeof(LOG_MAGIC));
+
+    // Old offset -> offset in the compacted log
+    std::unordered_map<std::uint64_t, std::uint64_t> newOffsets;
+    newOffsets.reserve(live.size());
+
+    for (const auto &entry : live) {
+        auto offset = data.size();
+        data.resize(offset + entry.size);
+        in.seekg(static_cast<std::streamoff>(entry.offset));
+        if (!in.read(&data[offset], entry.size)) {
+            return false;
+        }
+        newOffsets.emplace(entry.offset, offset);
+    }
+
+    std::filesystem::path tmpPath(path);
+    tmpPath += ".compact";
+
+    {
+        std::ofstream out(tmpPath.c_str(),
+                          std::ios::binary | std::ios::out | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!out) {
+            return false;
+        }
+    }
+
+    std::error_code ec;
+
+    if (syncMode != Backup::Durability::None) {
+        // The bulk of it, so only what's appended below is synced while we
+        // hold the lock
+        detail::syncFile(tmpPath, ec);
+        if (ec) {
+            return false;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    if (this->logGeneration != generation) {
+        // Replaced by a load or rewrite in the meantime
+        std::filesystem::remove(tmpPath, ec);
+        return false;
+    }
+
+    // Carry over the records appended while we copied
+    auto appendedSize = this->logSize - copiedSize;
+    if (appendedSize > 0) {
+        std::string appended(appendedSize, '\0');
+        in.clear();
+        in.seekg(static_cast<std::streamoff>(copiedSize));
+        if (!in.read(appended.data(),
+                     static_cast<std::streamsize>(appendedSize)) ||
+            !appendToFile(tmpPath, appended)) {
+            std::filesystem::remove(tmpPath, ec);
+            return false;
+        }
+    }
+
+    in.close();
+
+    if (!replaceFile(tmpPath, path, this->durability)) {
+        std::filesystem::remove(tmpPath, ec);
+        return false;
+    }
+
+    // Records that were live when we started and still are, and the ones
+    // appended since
+    for (auto &[recordPath, entry] : this->index) {
+        if (entry.offset >= copiedSize) {
+            entry.offset = entry.offset - copiedSize + data.size();
+        } else {
+            entry.offset = newOffsets.at(entry.offset);
+        }
+    }
+    this->logSize = data.size() + appendedSize;
+
+    return true;
+}
+
+void
+LogBackend::compactIfNeeded()
+{
+    if (this->logSize < this->compactionThreshold ||
+        this->logSize < 2 * (this->liveSize + LOG_HEADER_SIZE)) {
+        return;
+    }
+
+    if (this->compaction.valid() &&
+        this->compaction.wait_for(std::chrono::seconds(0)) !=
+            std::future_status::ready) {
+        // A compaction is already queued up
+        return;
+    }
+
+    this->compaction =
+        std::async(std::launch::async, [this] {
+            return this->compact();
+        });
+}
+
+}  // namespace pajlada::Settings
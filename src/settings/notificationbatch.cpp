@@ -0,0 +1,52 @@
+#include <pajlada/settings/notificationbatch.hpp>
+#include <vector>
+
+namespace pajlada::Settings {
+
+namespace {
+
+thread_local int batchDepth = 0;
+thread_local std::vector<std::function<void()>> deferredCallbacks;
+
+}  // namespace
+
+NotificationBatch::NotificationBatch()
+{
+    ++batchDepth;
+}
+
+NotificationBatch::~NotificationBatch()
+{
+    if (--batchDepth > 0) {
+        return;
+    }
+
+    // Deferred callbacks may defer more callbacks
+    while (!deferredCallbacks.empty()) {
+        std::vector<std::function<void()>> callbacks;
+        callbacks.swap(deferredCallbacks);
+
+        for (auto &callback : callbacks) {
+            callback();
+        }
+    }
+}
+
+bool
+NotificationBatch::active()
+{
+    return batchDepth > 0;
+}
+
+void
+NotificationBatch::defer(std::function<void()> callback)
+{
+    if (batchDepth == 0) {
+        callback();
+        return;
+    }
+
+    deferredCallbacks.push_back(std::move(callback));
+}
+
+}  // namespace pajlada::Settings
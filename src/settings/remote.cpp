@@ -0,0 +1,604 @@
+#include <rapidjson/document.h>
+#include <rapidjson/pointer.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <pajlada/settings/detail/pointer.hpp>
+#include <pajlada/settings/remote.hpp>
+#include <pajlada/settings/settingmanager.hpp>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+namespace pajlada::Settings {
+
+namespace detail {
+
+void
+RemoteDeltaQueue::push(std::string path, std::string json)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    // Pending values at or below `path` are overwritten by this one
+    std::erase_if(this->deltas, [&path](const auto &delta) {
+        return isSameOrChild(delta.path, path);
+    });
+
+    this->deltas.push_back(RemoteDelta{
+        .path = std::move(path),
+        .json = std::move(json),
+    });
+}
+
+std::vector<RemoteDelta>
+RemoteDeltaQueue::take()
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    return std::exchange(this->deltas, {});
+}
+
+}  // namespace detail
+
+#ifndef _WIN32
+
+namespace {
+
+// Frames are a native-endian 32 bit length followed by a JSON array of
+// [path, value] pairs
+// A peer announcing a longer frame is dropped instead of being buffered for
+constexpr std::uint32_t MAX_FRAME_LENGTH = 64 * 1024 * 1024;
+
+// A client with more than this waiting to be sent to it is dropped
+constexpr std::size_t MAX_CLIENT_OUTPUT = 2 * std::size_t{MAX_FRAME_LENGTH};
+
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+std::string
+encodeFrame(const std::vector<detail::RemoteDelta> &deltas)
+{
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+
+    writer.StartArray();
+    for (const auto &delta : deltas) {
+        writer.StartArray();
+        writer.String(delta.path.c_str(),
+                      static_cast<rapidjson::SizeType>(delta.path.size()));
+        writer.RawValue(delta.json.c_str(), delta.json.size(),
+                        rapidjson::kObjectType);
+        writer.EndArray();
+    }
+    writer.EndArray();
+
+    auto length = static_cast<std::uint32_t>(buffer.GetSize());
+
+    std::string frame(sizeof(length), '\0');
+    std::memcpy(frame.data(), &length, sizeof(length));
+    frame.append(buffer.GetString(), buffer.GetSize());
+
+    return frame;
+}
+
+bool
+sendAll(int fd, const std::string &data)
+{
+    std::size_t sent = 0;
+    while (sent < data.size()) {
+        auto n = ::send(fd, data.data() + sent, data.size() - sent, SEND_FLAGS);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        sent += static_cast<std::size_t>(n);
+    }
+
+    return true;
+}
+
+// Send as much of `output` as the non-blocking `fd` takes right now, and drop
+// what was sent from it
+//
+// Returns false if the connection is broken
+bool
+sendAvailable(int fd, std::string &output)
+{
+    std::size_t sent = 0;
+    while (sent < output.size()) {
+        auto n =
+            ::send(fd, output.data() + sent, output.size() - sent, SEND_FLAGS);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return false;
+        }
+        sent += static_cast<std::size_t>(n);
+    }
+
+    output.erase(0, sent);
+
+    return true;
+}
+
+// Read what's available from `fd` and call `onDelta(path, value)` for every
+// delta of every complete frame
+//
+// Returns false if the connection is closed or broken, or if the peer sent
+// something we can't apply (e.g. an invalid path)
+template <typename OnDelta>
+bool
+receiveFrames(int fd, std::string &buffer, OnDelta &&onDelta)
+{
+    char chunk[4096];
+    auto n = ::read(fd, chunk, sizeof(chunk));
+    if (n < 0) {
+        return errno == EINTR || errno == EAGAIN;
+    }
+    if (n == 0) {
+        return false;
+    }
+
+    buffer.append(chunk, static_cast<std::size_t>(n));
+
+    std::size_t offset = 0;
+    while (buffer.size() - offset >= sizeof(std::uint32_t)) {
+        std::uint32_t length = 0;
+        std::memcpy(&length, buffer.data() + offset, sizeof(length));
+        if (length > MAX_FRAME_LENGTH) {
+            return false;
+        }
+        if (buffer.size() - offset - sizeof(length) < length) {
+            // Wait for the rest of the frame
+            break;
+        }
+
+        rapidjson::Document frame;
+        frame.Parse(buffer.data() + offset + sizeof(length), length);
+        offset += sizeof(length) + length;
+
+        if (frame.HasParseError() || !frame.IsArray()) {
+            return false;
+        }
+
+        for (rapidjson::SizeType i = 0; i < frame.Size(); ++i) {
+            const auto &delta = frame[i];
+            if (!delta.IsArray() || delta.Size() != 2) {
+                return false;
+            }
+
+            const auto &path = *delta.Begin();
+            const auto &value = *(delta.Begin() + 1);
+            if (!path.IsString()) {
+                return false;
+            }
+
+            std::string pointer(path.GetString(), path.GetStringLength());
+            if (!rapidjson::Pointer(pointer.c_str()).IsValid()) {
+                return false;
+            }
+
+            onDelta(pointer, value);
+        }
+    }
+
+    buffer.erase(0, offset);
+
+    return true;
+}
+
+bool
+openWakePipe(int (&fds)[2])
+{
+    if (::pipe(fds) != 0) {
+        return false;
+    }
+
+    for (auto fd : fds) {
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+        ::fcntl(fd, F_SETFL, O_NONBLOCK);
+    }
+
+    return true;
+}
+
+void
+closeFds(std::initializer_list<int> fds)
+{
+    for (auto fd : fds) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+}
+
+void
+drainWakePipe(int fd)
+{
+    char buffer[64];
+    while (::read(fd, buffer, sizeof(buffer)) > 0) {
+    }
+}
+
+bool
+makeAddress(const std::filesystem::path &socketPath, sockaddr_un &address)
+{
+    const auto &native = socketPath.native();
+
+    address = {};
+    address.sun_family = AF_UNIX;
+    if (native.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    std::memcpy(address.sun_path, native.c_str(), native.size() + 1);
+
+    return true;
+}
+
+}  // namespace
+
+RemoteServer::RemoteServer(std::shared_ptr<SettingManager> _owner,
+                           std::filesystem::path _socketPath)
+    : owner(std::move(_owner))
+    , socketPath(std::move(_socketPath))
+{
+    sockaddr_un address{};
+    if (!makeAddress(this->socketPath, address)) {
+        return;
+    }
+
+    // A socket left behind by a previous owner
+    ::unlink(this->socketPath.c_str());
+
+    this->listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (this->listenFd < 0) {
+        return;
+    }
+    ::fcntl(this->listenFd, F_SETFD, FD_CLOEXEC);
+
+    if (::bind(this->listenFd, reinterpret_cast<sockaddr *>(&address),
+               sizeof(address)) != 0 ||
+        ::listen(this->listenFd, 16) != 0 || !openWakePipe(this->wakeFds)) {
+        ::close(this->listenFd);
+        this->listenFd = -1;
+        return;
+    }
+
+    // Taken while the owner holds its document, so deltas are queued in the
+    // order they were applied
+    this->owner->setDocumentObserver(
+        [this](const std::string &path, const rapidjson::Value &value) {
+            this->pending.push(path, SettingManager::stringify(value));
+            this->wake();
+        });
+
+    this->thread = std::thread([this] {
+        this->run();
+    });
+}
+
+RemoteServer::~RemoteServer()
+{
+    if (this->thread.joinable()) {
+        this->owner->setDocumentObserver({});
+
+        this->stopping = true;
+        this->wake();
+        this->thread.join();
+
+        ::unlink(this->socketPath.c_str());
+    }
+
+    closeFds({this->listenFd, this->wakeFds[0], this->wakeFds[1]});
+}
+
+bool
+RemoteServer::isRunning() const
+{
+    return this->thread.joinable();
+}
+
+void
+RemoteServer::wake()
+{
+    char c = 0;
+    (void)::write(this->wakeFds[1], &c, 1);
+}
+
+void
+RemoteServer::run()
+{
+    struct Client {
+        int fd;
+        std::string buffer;
+        // Frames the client hasn't taken yet
+        std::string output;
+    };
+
+    std::vector<Client> clients;
+    std::vector<pollfd> fds;
+
+    while (!this->stopping) {
+        fds.clear();
+        fds.push_back({.fd = this->listenFd, .events = POLLIN, .revents = 0});
+        fds.push_back({.fd = this->wakeFds[0], .events = POLLIN, .revents = 0});
+        for (const auto &client : clients) {
+            short events = POLLIN;
+            if (!client.output.empty()) {
+                events |= POLLOUT;
+            }
+            fds.push_back({.fd = client.fd, .events = events, .revents = 0});
+        }
+
+        if (::poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        std::vector<int> closed;
+
+        for (std::size_t i = 0; i < clients.size(); ++i) {
+            if ((fds[i + 2].revents & ~POLLOUT) == 0) {
+                continue;
+            }
+
+            auto &client = clients[i];
+            bool ok = receiveFrames(
+                client.fd, client.buffer,
+                [this](const std::string &path, const rapidjson::Value &value) {
+                    if (path.empty()) {
+                        // Only the owner can replace the whole document
+                        return;
+                    }
+
+                    SignalArgs args;
+                    args.source = SignalArgs::Source::External;
+
+                    // Applied under the document lock of the owner, which its
+                    // readers take too
+                    this->owner->set(path.c_str(), value, std::move(args));
+                });
+            if (!ok) {
+                closed.push_back(client.fd);
+            }
+        }
+
+        if ((fds[1].revents & POLLIN) != 0) {
+            drainWakePipe(this->wakeFds[0]);
+
+            auto deltas = this->pending.take();
+            if (!deltas.empty()) {
+                auto frame = encodeFrame(deltas);
+                for (auto &client : clients) {
+                    client.output += frame;
+                }
+            }
+        }
+
+        if ((fds[0].revents & POLLIN) != 0) {
+            int clientFd = ::accept(this->listenFd, nullptr, nullptr);
+            if (clientFd >= 0) {
+                ::fcntl(clientFd, F_SETFD, FD_CLOEXEC);
+                ::fcntl(clientFd, F_SETFL, O_NONBLOCK);
+
+                // Start the client off with the full document. Writes that
+                // come in after the copy are queued in `pending`.
+                rapidjson::Document document;
+                this->owner->getCopy("", document);
+
+                std::vector<detail::RemoteDelta> snapshot{{
+                    .path = "",
+                    .json = SettingManager::stringify(document),
+                }};
+                clients.push_back(Client{
+                    .fd = clientFd,
+                    .buffer = {},
+                    .output = encodeFrame(snapshot),
+                });
+            }
+        }
+
+        // Whatever the clients take without blocking, the rest waits for
+        // POLLOUT
+        for (auto &client : clients) {
+            if (client.output.empty()) {
+                continue;
+            }
+
+            if (!sendAvailable(client.fd, client.output) ||
+                client.output.size() > MAX_CLIENT_OUTPUT) {
+                closed.push_back(client.fd);
+            }
+        }
+
+        for (auto fd : closed) {
+            auto it = std::find_if(clients.begin(), clients.end(),
+                                   [fd](const auto &client) {
+                                       return client.fd == fd;
+                                   });
+            if (it != clients.end()) {
+                ::close(it->fd);
+                clients.erase(it);
+            }
+        }
+    }
+
+    for (const auto &client : clients) {
+        ::close(client.fd);
+    }
+}
+
+RemoteClient::RemoteClient(std::shared_ptr<SettingManager> _mirror,
+                           std::filesystem::path socketPath)
+    : mirror(std::move(_mirror))
+{
+    this->mirror->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    sockaddr_un address{};
+    if (!makeAddress(socketPath, address)) {
+        return;
+    }
+
+    this->fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (this->fd < 0) {
+        return;
+    }
+    ::fcntl(this->fd, F_SETFD, FD_CLOEXEC);
+
+    if (::connect(this->fd, reinterpret_cast<sockaddr *>(&address),
+                  sizeof(address)) != 0 ||
+        !openWakePipe(this->wakeFds)) {
+        ::close(this->fd);
+        this->fd = -1;
+        return;
+    }
+
+    this->connected = true;
+
+    this->mirror->setRemoteWriter(
+        [this](const std::string &path, const rapidjson::Value &value) {
+            this->pending.push(path, SettingManager::stringify(value));
+            this->wake();
+        });
+
+    this->thread = std::thread([this] {
+        this->run();
+    });
+}
+
+RemoteClient::~RemoteClient()
+{
+    if (this->thread.joinable()) {
+        this->mirror->setRemoteWriter({});
+
+        this->stopping = true;
+        this->wake();
+        this->thread.join();
+    }
+
+    closeFds({this->fd, this->wakeFds[0], this->wakeFds[1]});
+}
+
+bool
+RemoteClient::isConnected() const
+{
+    return this->connected;
+}
+
+void
+RemoteClient::wake()
+{
+    char c = 0;
+    (void)::write(this->wakeFds[1], &c, 1);
+}
+
+void
+RemoteClient::run()
+{
+    std::string buffer;
+
+    while (!this->stopping) {
+        pollfd fds[2] = {
+            {.fd = this->fd, .events = POLLIN, .revents = 0},
+            {.fd = this->wakeFds[0], .events = POLLIN, .revents = 0},
+        };
+
+        if (::poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        if (fds[0].revents != 0) {
+            bool ok = receiveFrames(
+                this->fd, buffer,
+                [this](const std::string &path, const rapidjson::Value &value) {
+                    if (path.empty()) {
+                        rapidjson::Document document;
+                        document.CopyFrom(value, document.GetAllocator());
+                        this->mirror->replaceDocument(
+                            document, SignalArgs::Source::External);
+                        return;
+                    }
+
+                    SignalArgs args;
+                    args.source = SignalArgs::Source::External;
+                    args.compareBeforeSet = true;
+
+                    this->mirror->set(path.c_str(), value, std::move(args));
+                });
+            if (!ok) {
+                break;
+            }
+        }
+
+        if ((fds[1].revents & POLLIN) != 0) {
+            drainWakePipe(this->wakeFds[0]);
+
+            auto deltas = this->pending.take();
+            if (!deltas.empty() && !sendAll(this->fd, encodeFrame(deltas))) {
+                break;
+            }
+        }
+    }
+
+    this->connected = false;
+}
+
+#else
+
+RemoteServer::RemoteServer(std::shared_ptr<SettingManager> _owner,
+                           std::filesystem::path _socketPath)
+    : owner(std::move(_owner))
+    , socketPath(std::move(_socketPath))
+{
+}
+
+RemoteServer::~RemoteServer() = default;
+
+bool
+RemoteServer::isRunning() const
+{
+    return false;
+}
+
+RemoteClient::RemoteClient(std::shared_ptr<SettingManager> _mirror,
+                           std::filesystem::path /*socketPath*/)
+    : mirror(std::move(_mirror))
+{
+}
+
+RemoteClient::~RemoteClient() = default;
+
+bool
+RemoteClient::isConnected() const
+{
+    return false;
+}
+
+#endif
+
+}  // namespace pajlada::Settings
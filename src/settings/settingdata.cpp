@@ -3,10 +3,12 @@
 
 namespace pajlada::Settings {
 
-SettingData::SettingData(std::string _path,
-                         std::weak_ptr<SettingManager> _instance)
+SettingData::SettingData(
+    std::string _path, std::weak_ptr<SettingManager> _instance,
+    std::shared_ptr<const detail::FreezeEpoch> _freezeEpoch)
     : path(std::move(_path))
     , instance(std::move(_instance))
+    , freezeEpoch(std::move(_freezeEpoch))
 {
 }
 
@@ -19,7 +21,7 @@ SettingData::getPath() const
 void
 SettingData::notifyUpdate(const rapidjson::Value &value, SignalArgs args)
 {
-    ++this->updateIteration;
+    args.updateIteration = ++this->updateIteration;
 
     this->updated.invoke(value, args);
 }
@@ -30,6 +32,42 @@ SettingData::getUpdateIteration() const
     return this->updateIteration;
 }
 
+bool
+SettingData::getCopy(rapidjson::Document &out) const
+{
+    auto locked = this->instance.lock();
+    if (!locked) {
+        return false;
+    }
+
+    return locked->getCopy(this->path.c_str(), out);
+}
+
+bool
+SettingData::copyValue(rapidjson::Document &out) const
+{
+    auto locked = this->instance.lock();
+    if (!locked) {
+        return false;
+    }
+
+    return locked->copyValue(this->path.c_str(), out);
+}
+
+bool
+SettingData::isFrozen() const
+{
+    auto locked = this->instance.lock();
+
+    return locked && locked->isFrozen();
+}
+
+const std::shared_ptr<const detail::FreezeEpoch> &
+SettingData::getFreezeEpoch() const
+{
+    return this->freezeEpoch;
+}
+
 rapidjson::Value *
 SettingData::get() const
 {
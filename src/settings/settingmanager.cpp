@@ -1,30 +1,58 @@
 #include <rapidjson/prettywriter.h>
 #include <rapidjson/writer.h>
 
-#include <fstream>
+#include <algorithm>
 #include <iostream>
-#include <pajlada/settings/backup.hpp>
-#include <pajlada/settings/detail/realpath.hpp>
+#include <optional>
+#include <pajlada/settings/detail/filewatcher.hpp>
+#include <pajlada/settings/detail/persistenttree.hpp>
+#include <pajlada/settings/detail/prefixindex.hpp>
 #include <pajlada/settings/internal.hpp>
+#include <pajlada/settings/jsonfilebackend.hpp>
+#include <pajlada/settings/logbackend.hpp>
+#include <pajlada/settings/notificationbatch.hpp>
 #include <pajlada/settings/settingdata.hpp>
 #include <pajlada/settings/settingmanager.hpp>
+#include <pajlada/settings/transaction.hpp>
 #include <string>
+#include <thread>
 
 namespace pajlada::Settings {
 
+namespace {
+
+// Past this many changes, rebuilding the persistent document is cheaper than
+// patching it path by path
+constexpr std::size_t MAX_STALE_SNAPSHOT_PATHS = 4096;
+
+// Set while this thread invokes `aboutToSave`
+thread_local bool preparingSave = false;
+
+}  // namespace
+
 SettingManager::SettingManager()
-    : document(rapidjson::kObjectType)
+    : prefixIndex(std::make_unique<detail::PrefixIndex>())
+    , backend(std::make_unique<JsonFileBackend>())
+    , document(rapidjson::kObjectType)
 {
 }
 
 SettingManager::~SettingManager()
 {
+    this->setHotReloadEnabled(false);
+
+    // Applies everything that's still queued
+    this->applyThreadEnabled = false;
+    this->writeQueue.reset();
+
     // XXX(pajlada): Should settings automatically save on exit?
     // Or on each setting change?
     // Or only manually?
     if (this->hasSaveMethodFlag(SaveMethod::SaveOnExit)) {
         this->save();
     }
+
+    this->backend->flush();
 }
 
 void
@@ -32,7 +60,11 @@ SettingManager::pp(const std::string &prefix)
 {
     rapidjson::StringBuffer buffer;
     rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
-    this->document.Accept(writer);
+    {
+        std::lock_guard<std::mutex> lock(this->documentMutex);
+
+        this->document.Accept(writer);
+    }
 
     std::cout << prefix << buffer.GetString() << std::endl;
 }
@@ -72,24 +104,625 @@ bool
 SettingManager::set(const char *path, const rapidjson::Value &value,
                     SignalArgs args)
 {
-    if (args.compareBeforeSet) {
+    if (this->frozen.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    if (args.compareBeforeSet &&
+        !this->applyThreadEnabled.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(this->documentMutex);
+
         const auto *prevValue = rapidjson::Pointer(path).Get(this->document);
         if (prevValue != nullptr && *prevValue == value) {
             return false;
         }
     }
 
-    this->hasUnsavedChanges = true;
+    if (args.remote) {
+        RemoteWriter writer;
+
+        {
+            std::lock_guard<std::mutex> lock(this->remoteMutex);
+
+            writer = this->remoteWriter;
+        }
+
+        if (writer) {
+            // The owner will echo the value back to us
+            writer(path, value);
+            return true;
+        }
+    }
+
+    if (args.writeToFile &&
+        this->applyThreadEnabled.load(std::memory_order_acquire)) {
+        detail::WriteQueue::Write write;
+        write.path = path;
+        write.value.CopyFrom(value, write.value.GetAllocator());
+        write.args = std::move(args);
+
+        this->writeQueue->push(std::move(write));
+
+        return true;
+    }
+
+    this->hasUnsavedChanges = true;
+
+    if (args.writeToFile) {
+        {
+            std::lock_guard<std::mutex> lock(this->documentMutex);
+
+            if (this->frozen.load(std::memory_order_relaxed)) {
+                // Frozen while we were getting here
+                return false;
+            }
+
+            rapidjson::Pointer(path).Set(this->document, value);
+            this->documentChanged(path);
+        }
+        this->markDirty(path);
+
+        if (this->hasSaveMethodFlag(SaveMethod::SaveOnSettingChange)) {
+            this->save();
+        }
+    }
+
+    this->notifyObservers(path, value, args);
+
+    this->notifyUpdate(path, value, std::move(args));
+
+    return true;
+}
+
+bool
+SettingManager::compareAndSet(const char *path,
+                              const rapidjson::Value *expected,
+                              const rapidjson::Value &value, SignalArgs args)
+{
+    {
+        std::lock_guard<std::mutex> lock(this->documentMutex);
+
+        if (this->frozen.load(std::memory_order_relaxed)) {
+            return false;
+        }
+
+        rapidjson::Pointer pointer(path);
+        const auto *current = pointer.Get(this->document);
+
+        bool unchanged = expected == nullptr
+                             ? current == nullptr
+                             : current != nullptr && *current == *expected;
+        if (!unchanged) {
+            return false;
+        }
+
+        pointer.Set(this->document, value);
+        this->documentChanged(path);
+    }
+
+    this->hasUnsavedChanges = true;
+    this->markDirty(path);
+
+    if (this->hasSaveMethodFlag(SaveMethod::SaveOnSettingChange)) {
+        this->save();
+    }
+
+    // The stored value may be replaced by other writers once we let go of
+    // the document, `value` is an equal copy that stays put
+    this->notifyObservers(path, value, args);
+
+    this->notifyUpdate(path, value, std::move(args));
+
+    return true;
+}
+
+bool
+SettingManager::getCopy(const char *path, rapidjson::Document &out)
+{
+    this->flush();
+
+    return this->copyValue(path, out);
+}
+
+bool
+SettingManager::copyValue(const char *path, rapidjson::Document &out)
+{
+    std::lock_guard<std::mutex> lock(this->documentMutex);
+
+    const auto *value = rapidjson::Pointer(path).Get(this->document);
+    if (value == nullptr) {
+        return false;
+    }
+
+    out.CopyFrom(*value, out.GetAllocator());
+
+    return true;
+}
+
+void
+SettingManager::setRemoteWriter(RemoteWriter writer)
+{
+    std::lock_guard<std::mutex> lock(this->remoteMutex);
+
+    this->remoteWriter = std::move(writer);
+}
+
+void
+SettingManager::setDocumentObserver(RemoteWriter observer)
+{
+    std::lock_guard<std::mutex> lock(this->documentMutex);
+
+    this->documentObserver = std::move(observer);
+}
+
+Signals::Connection
+SettingManager::connectPrefix(const std::string &prefix,
+                              PrefixCallback callback)
+{
+    return this->prefixIndex->connect(prefix, std::move(callback));
+}
+
+ChangeFeed &
+SettingManager::changeFeed()
+{
+    std::lock_guard<std::mutex> lock(this->changeFeedMutex);
+
+    if (!this->ownedChangeFeed) {
+        this->ownedChangeFeed.reset(new ChangeFeed);
+        this->activeChangeFeed.store(this->ownedChangeFeed.get(),
+                                     std::memory_order_release);
+    }
+
+    return *this->ownedChangeFeed;
+}
+
+std::uint64_t
+SettingManager::currentSequence() const
+{
+    return this->changeSequence.load(std::memory_order_acquire);
+}
+
+ChangesSince
+SettingManager::changesSince(std::uint64_t sequence) const
+{
+    return this->changeLog.since(sequence, this->currentSequence());
+}
+
+void
+SettingManager::setChangeLogCapacity(std::size_t capacity)
+{
+    this->changeLog.setCapacity(capacity, this->currentSequence());
+}
+
+void
+SettingManager::recordChange(const std::string &path, Change::Kind kind)
+{
+    Change change;
+    change.sequence =
+        this->changeSequence.fetch_add(1, std::memory_order_acq_rel) + 1;
+    change.path = path;
+    change.kind = kind;
+
+    this->changeLog.record(change);
+
+    if (auto *feed = this->activeChangeFeed.load(std::memory_order_acquire)) {
+        feed->push(std::move(change));
+    }
+}
+
+void
+SettingManager::documentChanged(const std::string &path)
+{
+    ++this->documentVersion;
+
+    if (this->reloading) {
+        this->writtenDuringReload.push_back(path);
+    }
+
+    if (this->documentObserver) {
+        auto observedPath = path;
+        const auto *value =
+            rapidjson::Pointer(observedPath.c_str()).Get(this->document);
+        while (value == nullptr) {
+            // Removed, the root is always there
+            observedPath.resize(observedPath.rfind('/'));
+            value =
+                rapidjson::Pointer(observedPath.c_str()).Get(this->document);
+        }
+
+        this->documentObserver(observedPath, *value);
+    }
+
+    if (!this->snapshotsEnabled || this->snapshotRebuildNeeded) {
+        return;
+    }
+
+    if (path.empty() ||
+        this->staleSnapshotPaths.size() >= MAX_STALE_SNAPSHOT_PATHS) {
+        this->snapshotRebuildNeeded = true;
+        this->staleSnapshotPaths.clear();
+        return;
+    }
+
+    this->staleSnapshotPaths.push_back(path);
+}
+
+Snapshot
+SettingManager::snapshot()
+{
+    std::lock_guard<std::mutex> lock(this->documentMutex);
+
+    this->snapshotsEnabled = true;
+
+    if (this->snapshotRebuildNeeded) {
+        this->snapshotRoot = detail::makePersistent(this->document);
+        this->snapshotRebuildNeeded = false;
+    } else {
+        for (const auto &path : this->staleSnapshotPaths) {
+            this->snapshotRoot = detail::updatePersistent(
+                this->snapshotRoot, this->document, path);
+        }
+    }
+    this->staleSnapshotPaths.clear();
+
+    return Snapshot(this->snapshotRoot, this->documentVersion);
+}
+
+void
+SettingManager::restore(const Snapshot &snapshot)
+{
+    if (this->isFrozen()) {
+        return;
+    }
+
+    rapidjson::Document restored;
+    snapshot.toDocument(restored);
+
+    {
+        std::lock_guard<std::mutex> lock(this->dirtyMutex);
+
+        this->fullPersistNeeded = true;
+    }
+
+    this->hasUnsavedChanges = true;
+
+    this->replaceDocument(restored, SignalArgs::Source::Setter);
+
+    if (this->hasSaveMethodFlag(SaveMethod::SaveOnSettingChange)) {
+        this->save();
+    }
+}
+
+void
+SettingManager::notifyObservers(const std::string &path,
+                                const rapidjson::Value &value,
+                                const SignalArgs &args)
+{
+    this->recordChange(path,
+                       path.empty() ? Change::Kind::Loaded : Change::Kind::Set);
+
+    this->updated.invoke(path, value, args);
+
+    this->prefixIndex->notify(path, value, args);
+}
+
+bool
+SettingManager::transaction(const std::function<void(Transaction &)> &stage)
+{
+    Transaction transaction(*this);
+
+    stage(transaction);
+
+    return transaction.commit();
+}
+
+void
+SettingManager::freeze()
+{
+    std::lock_guard<std::mutex> settingsLock(this->settingsMutex);
+    std::lock_guard<std::mutex> documentLock(this->documentMutex);
+
+    if (this->frozen.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    this->frozen.store(true, std::memory_order_release);
+    this->freezeEpoch->fetch_add(1, std::memory_order_acq_rel);
+}
+
+void
+SettingManager::thaw()
+{
+    std::lock_guard<std::mutex> settingsLock(this->settingsMutex);
+    std::lock_guard<std::mutex> documentLock(this->documentMutex);
+
+    if (!this->frozen.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    this->frozen.store(false, std::memory_order_seq_cst);
+    this->freezeEpoch->fetch_add(1, std::memory_order_acq_rel);
+
+    // Lookups that still saw us frozen read `settings` without the lock, let
+    // them finish before changing it
+    while (this->lockFreeReaders.load(std::memory_order_seq_cst) != 0) {
+        std::this_thread::yield();
+    }
+
+    this->settings.merge(this->frozenSettings);
+    this->frozenSettings.clear();
+}
+
+bool
+SettingManager::isFrozen() const
+{
+    return this->frozen.load(std::memory_order_acquire);
+}
+
+void
+SettingManager::setApplyThreadEnabled(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(this->writeQueueMutex);
+
+    if (enabled) {
+        if (!this->writeQueue) {
+            this->writeQueue = std::make_unique<detail::WriteQueue>(
+                [this](std::vector<detail::WriteQueue::Write> &writes) {
+                    this->applyWrites(writes);
+                });
+        }
+
+        this->applyThreadEnabled.store(true, std::memory_order_release);
+        return;
+    }
+
+    if (this->applyThreadEnabled.exchange(false, std::memory_order_acq_rel)) {
+        this->writeQueue->flush();
+    }
+}
+
+void
+SettingManager::flush()
+{
+    if (this->applyThreadEnabled.load(std::memory_order_acquire)) {
+        this->writeQueue->flush();
+    }
+}
+
+void
+SettingManager::applyWrites(std::vector<detail::WriteQueue::Write> &writes)
+{
+    std::vector<const detail::WriteQueue::Write *> applied;
+
+    {
+        std::lock_guard<std::mutex> lock(this->documentMutex);
+
+        if (this->frozen.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        for (const auto &write : writes) {
+            rapidjson::Pointer pointer(write.path.c_str());
+
+            if (write.args.compareBeforeSet) {
+                const auto *previous = pointer.Get(this->document);
+                if (previous != nullptr && *previous == write.value) {
+                    continue;
+                }
+            }
+
+            pointer.Set(this->document, write.value);
+            this->documentChanged(write.path);
+            applied.push_back(&write);
+        }
+    }
+
+    if (applied.empty()) {
+        return;
+    }
+
+    this->hasUnsavedChanges = true;
+
+    for (const auto *write : applied) {
+        this->markDirty(write->path);
+    }
+
+    if (this->hasSaveMethodFlag(SaveMethod::SaveOnSettingChange)) {
+        this->save();
+    }
+
+    NotificationBatch batch;
+
+    // Not the stored values, which other writers may replace once we let go
+    // of the document
+    for (const auto *write : applied) {
+        this->notifyObservers(write->path, write->value, write->args);
+
+        this->notifyUpdate(write->path, write->value, write->args);
+    }
+}
+
+bool
+SettingManager::commit(Transaction &transaction)
+{
+    if (this->frozen.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    // Queued values come first
+    this->flush();
+
+    auto writes = std::move(transaction.writes);
+    transaction.writes.clear();
+
+    // Values of Remote settings go to the owner instead, like in `set`
+    RemoteWriter remoteWriter;
+    {
+        std::lock_guard<std::mutex> lock(this->remoteMutex);
+
+        remoteWriter = this->remoteWriter;
+    }
+    std::vector<const Transaction::Write *> remoteWrites;
+
+    // What to put back at `path` on rollback. If there was no value, `path`
+    // is the outermost object that the write created.
+    struct Undo {
+        std::string path;
+        std::optional<rapidjson::Document> previous;
+        const Transaction::Write *write;
+    };
+    std::vector<Undo> undoLog;
+
+    // With `keepLaterWrites`, paths that have been written by someone else
+    // since we applied our values keep their current value
+    // Must be called with `documentMutex` held
+    auto rollback = [&](bool keepLaterWrites) {
+        for (auto it = undoLog.rbegin(); it != undoLog.rend(); ++it) {
+            rapidjson::Pointer pointer(it->path.c_str());
+
+            if (keepLaterWrites) {
+                const auto *current =
+                    rapidjson::Pointer(it->write->path.c_str())
+                        .Get(this->document);
+                if (current == nullptr || *current != it->write->value) {
+                    continue;
+                }
+            }
+
+            if (it->previous) {
+                pointer.Set(this->document, *it->previous);
+                this->documentChanged(it->path);
+                continue;
+            }
+
+            if (!keepLaterWrites) {
+                pointer.Erase(this->document);
+                this->documentChanged(it->path);
+                continue;
+            }
+
+            // Only our value and the parents it created that are still empty,
+            // others may have put values into them since
+            auto erasePath = it->write->path;
+            rapidjson::Pointer(erasePath.c_str()).Erase(this->document);
+            while (erasePath.length() > it->path.length()) {
+                erasePath.resize(erasePath.rfind('/'));
+
+                const auto *parent =
+                    rapidjson::Pointer(erasePath.c_str()).Get(this->document);
+                bool empty =
+                    parent != nullptr &&
+                    ((parent->IsObject() && parent->MemberCount() == 0) ||
+                     (parent->IsArray() && parent->Empty()));
+                if (!empty) {
+                    break;
+                }
+                rapidjson::Pointer(erasePath.c_str()).Erase(this->document);
+            }
+            this->documentChanged(erasePath);
+        }
+    };
+
+    std::vector<const Transaction::Write *> applied;
+
+    {
+        std::lock_guard<std::mutex> lock(this->documentMutex);
+
+        if (this->frozen.load(std::memory_order_relaxed)) {
+            // Frozen while we were getting here
+            transaction.writes = std::move(writes);
+            return false;
+        }
+
+        try {
+            for (const auto &write : writes) {
+                if (write.args.remote && remoteWriter) {
+                    remoteWrites.push_back(&write);
+                    continue;
+                }
+
+                if (!write.args.writeToFile) {
+                    // Only notified, like in `set`
+                    applied.push_back(&write);
+                    continue;
+                }
+
+                rapidjson::Pointer pointer(write.path.c_str());
+                const auto *previous = pointer.Get(this->document);
+
+                if (write.args.compareBeforeSet && previous != nullptr &&
+                    *previous == write.value) {
+                    continue;
+                }
+
+                Undo undo{write.path, std::nullopt, &write};
+                if (previous != nullptr) {
+                    undo.previous.emplace();
+                    undo.previous->CopyFrom(*previous,
+                                            undo.previous->GetAllocator());
+                } else {
+                    for (auto slash = write.path.find('/', 1);
+                         slash != std::string::npos;
+                         slash = write.path.find('/', slash + 1)) {
+                        auto parent = write.path.substr(0, slash);
+                        if (rapidjson::Pointer(parent.c_str())
+                                .Get(this->document) == nullptr) {
+                            undo.path = std::move(parent);
+                            break;
+                        }
+                    }
+                }
+                undoLog.push_back(std::move(undo));
+
+                pointer.Set(this->document, write.value);
+                this->documentChanged(write.path);
+                applied.push_back(&write);
+            }
+        } catch (...) {
+            rollback(false);
+            throw;
+        }
+    }
+
+    for (const auto *write : remoteWrites) {
+        // The owner will echo the value back to us
+        remoteWriter(write->path, write->value);
+    }
+
+    if (applied.empty()) {
+        return true;
+    }
 
-    if (args.writeToFile) {
-        rapidjson::Pointer(path).Set(this->document, value);
+    if (!undoLog.empty()) {
+        for (const auto &undo : undoLog) {
+            this->markDirty(undo.path);
+        }
 
         if (this->hasSaveMethodFlag(SaveMethod::SaveOnSettingChange)) {
-            this->save();
+            try {
+                this->save();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(this->documentMutex);
+                rollback(true);
+                throw;
+            }
         }
     }
 
-    this->notifyUpdate(path, value, std::move(args));
+    for (const auto *write : applied) {
+        if (write->storeLocally) {
+            write->storeLocally();
+        }
+    }
+
+    // One wave of notifications, after everything has been applied
+    NotificationBatch batch;
+
+    for (const auto *write : applied) {
+        this->notifyObservers(write->path, write->value, write->args);
+
+        this->notifyUpdate(write->path, write->value, write->args);
+    }
 
     return true;
 }
@@ -116,17 +749,34 @@ SettingManager::notifyLoadedValues()
 
     this->settingsMutex.unlock();
 
-    for (const auto &it : loadedSettings) {
-        auto *v = this->get(it.first.c_str());
-        if (v == nullptr) {
-            continue;
+    // Copied while we hold the document, the notifications run without it
+    std::vector<std::pair<std::shared_ptr<SettingData>, rapidjson::Document>>
+        loadedValues;
+
+    {
+        std::lock_guard<std::mutex> lock(this->documentMutex);
+
+        for (const auto &it : loadedSettings) {
+            const auto *v = rapidjson::Pointer(it.first.c_str()).Get(
+                this->document);
+            if (v == nullptr) {
+                continue;
+            }
+
+            auto &loaded = loadedValues.emplace_back(it.second,
+                                                     rapidjson::Document());
+            loaded.second.CopyFrom(*v, loaded.second.GetAllocator());
         }
+    }
 
+    NotificationBatch batch;
+
+    for (auto &[setting, value] : loadedValues) {
         // Maybe a "Load" source would make sense?
         SignalArgs args;
         args.source = SignalArgs::Source::Setter;
 
-        it.second->notifyUpdate(*v, std::move(args));
+        setting->notifyUpdate(value, std::move(args));
     }
 }
 
@@ -135,6 +785,8 @@ SettingManager::arraySize(const std::string &path)
 {
     const auto &instance = SettingManager::getInstance();
 
+    std::lock_guard<std::mutex> lock(instance->documentMutex);
+
     auto *valuePointer =
         rapidjson::Pointer(path.c_str()).Get(instance->document);
     if (valuePointer == nullptr) {
@@ -163,6 +815,8 @@ SettingManager::isNull(const std::string &path)
 bool
 SettingManager::_isNull(const std::string &path)
 {
+    std::lock_guard<std::mutex> lock(this->documentMutex);
+
     auto *valuePointer = rapidjson::Pointer(path.c_str()).Get(this->document);
     if (valuePointer == nullptr) {
         return true;
@@ -176,8 +830,19 @@ SettingManager::setNull(const std::string &path)
 {
     const auto &instance = SettingManager::getInstance();
 
-    rapidjson::Pointer(path.c_str())
-        .Set(instance->document, rapidjson::Value());
+    {
+        std::lock_guard<std::mutex> lock(instance->documentMutex);
+
+        if (instance->frozen.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        rapidjson::Pointer(path.c_str())
+            .Set(instance->document, rapidjson::Value());
+        instance->documentChanged(path);
+    }
+    instance->markDirty(path);
+    instance->recordChange(path, Change::Kind::Set);
 }
 
 bool
@@ -186,31 +851,42 @@ SettingManager::removeArrayValue(const std::string &arrayPath,
 {
     const auto &instance = SettingManager::getInstance();
 
+    if (instance->isFrozen()) {
+        return false;
+    }
+
     instance->clearSettings(arrayPath + "/" + std::to_string(index) + "/");
 
-    rapidjson::SizeType size = SettingManager::arraySize(arrayPath);
+    bool removedLast = false;
+    {
+        std::lock_guard<std::mutex> lock(instance->documentMutex);
 
-    if (size == 0) {
-        // No values to remove
-        return false;
-    }
+        auto *valuePointer =
+            rapidjson::Pointer(arrayPath.c_str()).Get(instance->document);
+        if (valuePointer == nullptr || !valuePointer->IsArray()) {
+            // No values to remove
+            return false;
+        }
 
-    if (index >= size) {
-        // Index out of bounds
-        return false;
-    }
+        rapidjson::Value &array = *valuePointer;
 
-    auto *valuePointer =
-        rapidjson::Pointer(arrayPath.c_str()).Get(instance->document);
-    if (valuePointer == nullptr) {
-        return false;
-    }
+        if (index >= array.Size()) {
+            // Index out of bounds
+            return false;
+        }
 
-    rapidjson::Value &array = *valuePointer;
+        if (index == array.Size() - 1) {
+            // We want to remove the last element
+            array.PopBack();
+            instance->documentChanged(arrayPath);
+            removedLast = true;
+        }
+    }
 
-    if (index == size - 1) {
-        // We want to remove the last element
-        array.PopBack();
+    if (removedLast) {
+        instance->markDirty(arrayPath);
+        instance->recordChange(arrayPath + "/" + std::to_string(index),
+                               Change::Kind::Removed);
     } else {
         SettingManager::setNull(arrayPath + "/" + std::to_string(index));
     }
@@ -251,6 +927,8 @@ SettingManager::getObjectKeys(const std::string &objectPath)
 
     std::vector<std::string> ret;
 
+    std::lock_guard<std::mutex> lock(instance->documentMutex);
+
     auto *root = instance->get(objectPath.c_str());
 
     if (root == nullptr || !root->IsObject()) {
@@ -271,11 +949,34 @@ SettingManager::clear()
     const auto &instance = SettingManager::getInstance();
 
     // Clear document
-    rapidjson::Value(rapidjson::kObjectType).Swap(instance->document);
+    {
+        std::lock_guard<std::mutex> lock(instance->documentMutex);
+
+        if (instance->frozen.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        rapidjson::Value(rapidjson::kObjectType).Swap(instance->document);
+        instance->documentChanged("");
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(instance->dirtyMutex);
+
+        instance->dirtyPaths.clear();
+        instance->fullPersistNeeded = true;
+    }
+
+    instance->recordChange("", Change::Kind::Removed);
 
     // Clear map of settings
     std::lock_guard<std::mutex> lock(instance->settingsMutex);
 
+    if (instance->frozen.load(std::memory_order_relaxed)) {
+        // Frozen in the meantime, lookups might be reading the map
+        return;
+    }
+
     instance->settings.clear();
 }
 
@@ -293,6 +994,11 @@ SettingManager::_removeSetting(const std::string &path)
     auto ptr = rapidjson::Pointer(path.c_str());
 
     std::lock_guard<std::mutex> lock(this->settingsMutex);
+    std::lock_guard<std::mutex> documentLock(this->documentMutex);
+
+    if (this->frozen.load(std::memory_order_relaxed)) {
+        return false;
+    }
 
     this->settings.erase(path);
 
@@ -310,13 +1016,23 @@ SettingManager::_removeSetting(const std::string &path)
         if (p.first.compare(0, pathWithExtendor.length(), pathWithExtendor) ==
             0) {
             rapidjson::Pointer(p.first.c_str()).Erase(this->document);
+            this->documentChanged(p.first);
             this->settings.erase(iter++);
         } else {
             ++iter;
         }
     }
 
-    return ptr.Erase(this->document);
+    this->markDirty(path);
+
+    if (!ptr.Erase(this->document)) {
+        return false;
+    }
+    this->documentChanged(path);
+
+    this->recordChange(path, Change::Kind::Removed);
+
+    return true;
 }
 
 void
@@ -324,6 +1040,10 @@ SettingManager::clearSettings(const std::string &root)
 {
     std::lock_guard<std::mutex> lock(this->settingsMutex);
 
+    if (this->frozen.load(std::memory_order_relaxed)) {
+        return;
+    }
+
     std::vector<std::string> keysToBeRemoved;
 
     for (const auto &setting : this->settings) {
@@ -340,7 +1060,33 @@ SettingManager::clearSettings(const std::string &root)
 void
 SettingManager::setPath(const std::filesystem::path &newPath)
 {
-    this->filePath = newPath;
+    bool changed = false;
+    {
+        std::lock_guard<std::mutex> lock(this->filePathMutex);
+
+        changed = this->filePath != newPath;
+        this->filePath = newPath;
+    }
+
+    this->backend->invalidate();
+
+    if (changed) {
+        std::unique_lock<std::mutex> lock(this->watcherMutex);
+
+        // The old watcher must be destroyed without the lock held, its
+        // thread might be reloading (and saving) right now
+        auto oldWatcher = std::move(this->watcher);
+        this->restartWatcher();
+        lock.unlock();
+    }
+}
+
+std::filesystem::path
+SettingManager::currentPath() const
+{
+    std::lock_guard<std::mutex> lock(this->filePathMutex);
+
+    return this->filePath;
 }
 
 SettingManager::LoadError
@@ -363,61 +1109,43 @@ SettingManager::LoadError
 SettingManager::load(const std::filesystem::path &path)
 {
     if (!path.empty()) {
-        this->filePath = path;
+        this->setPath(path);
     }
 
-    return this->loadFrom(this->filePath);
+    return this->loadFrom(this->currentPath());
 }
 
 SettingManager::LoadError
-SettingManager::loadFrom(const std::filesystem::path &_path)
+SettingManager::loadFrom(const std::filesystem::path &path)
 {
-    std::error_code ec;
-
-    auto path = detail::RealPath(_path, ec);
-
-    if (ec) {
-        return LoadError::FileHandleError;
-    }
+    LoadError error = LoadError::NoError;
+    // What observers are notified with, the document may change as soon as
+    // we let go of it
+    rapidjson::Document loaded;
+    {
+        std::lock_guard<std::mutex> lock(this->documentMutex);
+
+        if (this->frozen.load(std::memory_order_relaxed)) {
+            return LoadError::Frozen;
+        }
 
-    // Open file
-    std::ifstream fh(path.c_str(), std::ios::binary | std::ios::in);
-    if (!fh) {
-        // Unable to open file at `path`
-        return LoadError::CannotOpenFile;
-    }
+        error = this->backend->load(path, this->document);
+        this->documentChanged("");
 
-    // Read size of file
-    auto fileSize = std::filesystem::file_size(path, ec);
-    if (ec) {
-        return LoadError::FileHandleError;
+        if (error == LoadError::NoError) {
+            loaded.CopyFrom(this->document, loaded.GetAllocator());
+        }
     }
-
-    if (fileSize == 0) {
-        // Nothing to load
-        return LoadError::NoError;
+    if (error != LoadError::NoError) {
+        return error;
     }
 
-    // Create std::vector of appropriate size
-    std::vector<char> fileBuffer;
-    fileBuffer.resize(fileSize);
+    {
+        std::lock_guard<std::mutex> lock(this->dirtyMutex);
 
-    // Read file data into buffer
-    fh.read(&fileBuffer[0], fileSize);
-
-    // Merge newly parsed config file into our pre-existing document
-    // The pre-existing document might be empty, but we don't know that
-
-    rapidjson::ParseResult ok = this->document.Parse(&fileBuffer[0], fileSize);
-
-    // Make sure the file parsed okay
-    if (!ok) {
-        return LoadError::JSONParseError;
-    }
-
-    // This restricts config files a bit. They NEED to have an object root
-    if (!this->document.IsObject()) {
-        return LoadError::JSONParseError;
+        // Values set before loading are still tracked in dirtyPaths, so the
+        // loaded path doesn't need a full persist
+        this->persistedPath = path;
     }
 
     // Perform deep merge of objects
@@ -425,6 +1153,11 @@ SettingManager::loadFrom(const std::filesystem::path &_path)
 
     this->notifyLoadedValues();
 
+    SignalArgs args;
+    args.source = SignalArgs::Source::Setter;
+
+    this->notifyObservers("", loaded, args);
+
     return LoadError::NoError;
 }
 
@@ -448,68 +1181,398 @@ SettingManager::SaveResult
 SettingManager::save(const std::filesystem::path &path)
 {
     if (!path.empty()) {
-        this->filePath = path;
+        this->setPath(path);
     }
 
-    return this->saveAs(this->filePath);
+    return this->saveAs(this->currentPath());
 }
 
 SettingManager::SaveResult
 SettingManager::saveAs(const std::filesystem::path &path)
 {
+    if (preparingSave) {
+        return SaveResult::Skipped;
+    }
+
+    preparingSave = true;
+    try {
+        this->aboutToSave.invoke();
+    } catch (...) {
+        preparingSave = false;
+        throw;
+    }
+    preparingSave = false;
+
     if (this->hasSaveMethodFlag(SaveMethod::OnlySaveIfChanged) &&
         !this->hasUnsavedChanges) {
         // No save necessary - no changes have been made
         return SaveResult::Skipped;
     }
 
-    std::error_code ec;
-    Backup::saveWithBackup(
-        path, this->backup,
-        [this](const auto &tmpPath, auto &ec) {
-            if (!this->writeTo(tmpPath)) {
-                ec = std::make_error_code(std::errc::io_error);
-            } else {
-                this->hasUnsavedChanges = false;
-            }
-        },
-        ec);
+    // Saves persist in the order they copied the document, so an older copy
+    // never overwrites a newer one
+    std::lock_guard<std::mutex> saveLock(this->saveMutex);
+
+    PersistRequest request;
+    rapidjson::Document copy;
+
+    {
+        // Writers only wait for the copy, not for the disk
+        std::lock_guard<std::mutex> documentLock(this->documentMutex);
+        std::lock_guard<std::mutex> dirtyLock(this->dirtyMutex);
+
+        request.full = this->fullPersistNeeded || this->persistedPath != path;
+        request.dirtyPaths.assign(this->dirtyPaths.begin(),
+                                  this->dirtyPaths.end());
+        this->dirtyPaths.clear();
+        this->fullPersistNeeded = false;
+        this->hasUnsavedChanges = false;
+
+        copy.CopyFrom(this->document, copy.GetAllocator());
+    }
+
+    // Our own save must not be reloaded, even if the watcher looks at the
+    // file before we're done
+    bool watched = path == this->currentPath();
+    if (watched) {
+        std::lock_guard<std::mutex> lock(this->watcherMutex);
+
+        if (this->watcher) {
+            this->watcher->beginOwnWrite();
+        }
+    }
+
+    bool persisted = this->backend->persist(path, copy, request);
+
+    if (watched) {
+        std::lock_guard<std::mutex> lock(this->watcherMutex);
+
+        if (this->watcher) {
+            this->watcher->endOwnWrite(persisted);
+        }
+    }
+
+    if (!persisted) {
+        std::lock_guard<std::mutex> lock(this->dirtyMutex);
+
+        // Try again with the next save
+        this->dirtyPaths.insert(request.dirtyPaths.begin(),
+                                request.dirtyPaths.end());
+        this->fullPersistNeeded = this->fullPersistNeeded || request.full;
+        this->hasUnsavedChanges = true;
 
-    if (ec) {
         return SaveResult::Failed;
     }
 
+    {
+        std::lock_guard<std::mutex> lock(this->dirtyMutex);
+
+        this->persistedPath = path;
+    }
+
     return SaveResult::Success;
 }
 
+SettingManager::LoadError
+SettingManager::reload()
+{
+    std::lock_guard<std::mutex> reloadLock(this->reloadMutex);
+
+    if (this->isFrozen()) {
+        return LoadError::Frozen;
+    }
+
+    auto path = this->currentPath();
+
+    {
+        std::lock_guard<std::mutex> lock(this->documentMutex);
+
+        // Writes made while we read the file must survive the swap
+        this->reloading = true;
+        this->writtenDuringReload.clear();
+    }
+
+    // An empty file is most likely being written by someone else right now
+    // (truncated, but not written yet). Its change will be reported again
+    // once it's written, so keep our document until then
+    auto isEmpty = [&path] {
+        std::error_code ec;
+        return std::filesystem::file_size(path, ec) == 0 && !ec;
+    };
+
+    // Left untouched (null) by the backend if there was nothing to load
+    rapidjson::Document loaded;
+
+    auto error = isEmpty() ? LoadError::FileEmpty
+                           : this->backend->load(path, loaded);
+    if (error == LoadError::NoError && (loaded.IsNull() || isEmpty())) {
+        error = LoadError::FileEmpty;
+    }
+    if (error != LoadError::NoError) {
+        std::lock_guard<std::mutex> lock(this->documentMutex);
+
+        this->reloading = false;
+        this->writtenDuringReload.clear();
+
+        return error;
+    }
+
+    this->replaceDocument(loaded, SignalArgs::Source::External, &path);
+
+    return LoadError::NoError;
+}
+
+void
+SettingManager::keepWritesDuringReload(rapidjson::Document &newDocument,
+                                       const std::filesystem::path &path)
+{
+    auto written = std::move(this->writtenDuringReload);
+    this->writtenDuringReload.clear();
+    this->reloading = false;
+
+    bool keepAll = std::find(written.begin(), written.end(), "") !=
+                   written.end();
+
+    if (keepAll) {
+        // Replaced as a whole while we read the file, the file is outdated
+        newDocument.CopyFrom(this->document, newDocument.GetAllocator());
+    } else {
+        for (const auto &writtenPath : written) {
+            rapidjson::Pointer pointer(writtenPath.c_str());
+
+            const auto *current = pointer.Get(this->document);
+            if (current != nullptr) {
+                pointer.Set(newDocument,
+                            rapidjson::Value(*current,
+                                             newDocument.GetAllocator()));
+            } else {
+                pointer.Erase(newDocument);
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(this->dirtyMutex);
+
+    // The document matches the file again, except for what we kept
+    this->dirtyPaths.clear();
+    this->dirtyPaths.insert(written.begin(), written.end());
+    this->fullPersistNeeded = keepAll;
+    this->persistedPath = path;
+
+    // Never cleared here, a write that's about to take the document might
+    // have set it already
+    if (!written.empty()) {
+        this->hasUnsavedChanges = true;
+    }
+}
+
+void
+SettingManager::replaceDocument(rapidjson::Document &newDocument,
+                                SignalArgs::Source source,
+                                const std::filesystem::path *reloadedFrom)
+{
+    this->settingsMutex.lock();
+
+    auto loadedSettings = this->settings;
+
+    this->settingsMutex.unlock();
+
+    // The new values of the changed settings, copied while we hold the
+    // document, the notifications run without it
+    std::vector<std::pair<std::shared_ptr<SettingData>, rapidjson::Document>>
+        changedSettings;
+    rapidjson::Document replaced;
+
+    {
+        std::lock_guard<std::mutex> lock(this->documentMutex);
+
+        if (this->frozen.load(std::memory_order_relaxed)) {
+            if (reloadedFrom != nullptr) {
+                this->reloading = false;
+                this->writtenDuringReload.clear();
+            }
+            return;
+        }
+
+        if (reloadedFrom != nullptr) {
+            this->keepWritesDuringReload(newDocument, *reloadedFrom);
+        }
+
+        for (const auto &[path, setting] : loadedSettings) {
+            const auto *oldValue =
+                rapidjson::Pointer(path.c_str()).Get(this->document);
+            const auto *newValue =
+                rapidjson::Pointer(path.c_str()).Get(newDocument);
+
+            if (oldValue == nullptr && newValue == nullptr) {
+                continue;
+            }
+
+            if (oldValue != nullptr && newValue != nullptr &&
+                *oldValue == *newValue) {
+                continue;
+            }
+
+            // Null if the value is gone
+            auto &changed =
+                changedSettings.emplace_back(setting, rapidjson::Document());
+            if (newValue != nullptr) {
+                changed.second.CopyFrom(*newValue,
+                                        changed.second.GetAllocator());
+            }
+        }
+
+        this->document.Swap(newDocument);
+        this->documentChanged("");
+
+        replaced.CopyFrom(this->document, replaced.GetAllocator());
+    }
+
+    NotificationBatch batch;
+
+    for (auto &[setting, value] : changedSettings) {
+        SignalArgs args;
+        args.source = source;
+
+        setting->notifyUpdate(value, std::move(args));
+    }
+
+    SignalArgs args;
+    args.source = source;
+
+    this->notifyObservers("", replaced, args);
+}
+
 bool
-SettingManager::writeTo(const std::filesystem::path &path)
+SettingManager::setHotReloadEnabled(bool enabled,
+                                    std::chrono::milliseconds debounce)
 {
-    std::ofstream fh(path.c_str(), std::ios::binary | std::ios::out);
-    if (!fh) {
-        // Unable to open file at `path`
-        return false;
+    std::unique_lock<std::mutex> lock(this->watcherMutex);
+
+    this->hotReloadEnabled = enabled;
+    this->hotReloadDebounce = debounce;
+
+    auto oldWatcher = std::move(this->watcher);
+    this->restartWatcher();
+
+    bool running = this->watcher != nullptr;
+
+    lock.unlock();
+
+    return running;
+}
+
+void
+SettingManager::restartWatcher()
+{
+    if (!this->hotReloadEnabled) {
+        return;
     }
 
-    rapidjson::StringBuffer buffer;
-    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
-    this->document.Accept(writer);
+    auto newWatcher = std::make_unique<detail::FileWatcher>(
+        this->currentPath(), this->hotReloadDebounce, [this] {
+            this->reload();
+        });
 
-    fh.write(buffer.GetString(), buffer.GetSize());
+    if (newWatcher->isRunning()) {
+        this->watcher = std::move(newWatcher);
+    }
+}
 
-    return true;
+void
+SettingManager::setBackend(std::unique_ptr<Backend> newBackend)
+{
+    this->backend->flush();
+
+    this->backend = std::move(newBackend);
+
+    std::lock_guard<std::mutex> lock(this->dirtyMutex);
+
+    this->persistedPath.clear();
+}
+
+Backend &
+SettingManager::getBackend()
+{
+    return *this->backend;
+}
+
+void
+SettingManager::addShard(const std::string &pointer,
+                         const std::filesystem::path &path)
+{
+    if (auto *fileBackend =
+            dynamic_cast<JsonFileBackend *>(this->backend.get())) {
+        fileBackend->addShard(pointer, path);
+    }
+}
+
+void
+SettingManager::markDirty(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(this->dirtyMutex);
+
+    this->dirtyPaths.insert(path);
+    // Raised again after the write, in case a save took the document in
+    // between and cleared it
+    this->hasUnsavedChanges = true;
 }
 
 void
 SettingManager::setBackupEnabled(bool enabled)
 {
-    this->backup.enabled = enabled;
+    if (auto *fileBackend =
+            dynamic_cast<JsonFileBackend *>(this->backend.get())) {
+        fileBackend->setBackupEnabled(enabled);
+    }
 }
 
 void
 SettingManager::setBackupSlots(uint8_t numSlots)
 {
-    this->backup.numSlots = numSlots;
+    if (auto *fileBackend =
+            dynamic_cast<JsonFileBackend *>(this->backend.get())) {
+        fileBackend->setBackupSlots(numSlots);
+    }
+}
+
+void
+SettingManager::setBackupRotation(Backup::Rotation rotation)
+{
+    if (auto *fileBackend =
+            dynamic_cast<JsonFileBackend *>(this->backend.get())) {
+        fileBackend->setBackupRotation(rotation);
+    }
+}
+
+void
+SettingManager::setBackupDeltasEnabled(bool enabled)
+{
+    if (auto *fileBackend =
+            dynamic_cast<JsonFileBackend *>(this->backend.get())) {
+        fileBackend->setBackupDeltasEnabled(enabled);
+    }
+}
+
+void
+SettingManager::setDurability(Backup::Durability durability)
+{
+    if (auto *fileBackend =
+            dynamic_cast<JsonFileBackend *>(this->backend.get())) {
+        fileBackend->setDurability(durability);
+    } else if (auto *logBackend =
+                   dynamic_cast<LogBackend *>(this->backend.get())) {
+        logBackend->setDurability(durability);
+    }
+}
+
+void
+SettingManager::setBackupDeferred(bool deferred)
+{
+    if (auto *fileBackend =
+            dynamic_cast<JsonFileBackend *>(this->backend.get())) {
+        fileBackend->setBackupDeferred(deferred);
+    }
 }
 
 std::weak_ptr<SettingData>
@@ -520,13 +1583,43 @@ SettingManager::getSetting(const std::string &path,
         instance = SettingManager::getInstance();
     }
 
+    {
+        // The registry doesn't change while frozen. Registering as a reader
+        // before looking at `frozen` makes `thaw` wait for us.
+        std::shared_ptr<SettingData> found;
+
+        instance->lockFreeReaders.fetch_add(1, std::memory_order_seq_cst);
+        if (instance->frozen.load(std::memory_order_seq_cst)) {
+            auto it = instance->settings.find(path);
+            if (it != instance->settings.end()) {
+                found = it->second;
+            }
+        }
+        instance->lockFreeReaders.fetch_sub(1, std::memory_order_release);
+
+        if (found) {
+            return found;
+        }
+    }
+
     std::lock_guard<std::mutex> lock(instance->settingsMutex);
 
+    if (instance->frozen.load(std::memory_order_relaxed)) {
+        auto &setting = instance->frozenSettings[path];
+        if (setting == nullptr) {
+            setting.reset(
+                new SettingData(path, instance, instance->freezeEpoch));
+        }
+
+        return setting;
+    }
+
     auto &setting = instance->settings[path];
 
     if (setting == nullptr) {
         // No setting has been created with this path
-        setting.reset(new SettingData(path, instance));
+        setting.reset(
+            new SettingData(path, instance, instance->freezeEpoch));
     }
 
     return std::static_pointer_cast<SettingData>(setting);
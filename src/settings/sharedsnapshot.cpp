@@ -0,0 +1,557 @@
+#include <rapidjson/pointer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <optional>
+#include <pajlada/settings/detail/pointer.hpp>
+#include <pajlada/settings/detail/timerwheel.hpp>
+#include <pajlada/settings/settingmanager.hpp>
+#include <pajlada/settings/sharedsnapshot.hpp>
+#include <string_view>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace pajlada::Settings {
+
+namespace {
+
+/// Contents of the `<name>` segment
+struct Control {
+    std::atomic<std::uint64_t> generation;
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+              "The generation counter is shared between processes");
+
+constexpr char SNAPSHOT_MAGIC[8] = {'P', 'S', 'S', 'N', 'A', 'P', '0', '2'};
+
+/// A snapshot segment starts with a header, followed by `entryCount` entries
+/// sorted by path (`detail::pointerLess`) and the strings they point to.
+///
+/// Containers are stored as "{}" or "[]", their members follow as separate
+/// entries. Paths sort right before the paths of their children, so a subtree
+/// is a contiguous range of entries.
+struct SnapshotHeader {
+    char magic[8];
+    std::uint64_t generation;
+    std::uint64_t entryCount;
+    std::uint64_t size;
+};
+
+struct SnapshotEntry {
+    std::uint64_t pathOffset;
+    std::uint64_t pathLength;
+    std::uint64_t valueOffset;
+    std::uint64_t valueLength;
+};
+
+struct FlatValue {
+    std::string path;
+    std::string json;
+};
+
+void
+flatten(const rapidjson::Value &value, std::string &path,
+        std::vector<FlatValue> &out)
+{
+    if (value.IsObject()) {
+        out.push_back({path, "{}"});
+
+        for (auto it = value.MemberBegin(); it != value.MemberEnd(); ++it) {
+            auto length = path.length();
+            detail::appendPointerToken(
+                path, {it->name.GetString(), it->name.GetStringLength()});
+            flatten(it->value, path, out);
+            path.resize(length);
+        }
+    } else if (value.IsArray()) {
+        out.push_back({path, "[]"});
+
+        for (rapidjson::SizeType i = 0; i < value.Size(); ++i) {
+            auto length = path.length();
+            detail::appendPointerToken(path, std::to_string(i));
+            flatten(value[i], path, out);
+            path.resize(length);
+        }
+    } else {
+        out.push_back({path, SettingManager::stringify(value)});
+    }
+}
+
+std::string
+segmentName(const std::string &name)
+{
+    if (name.empty() || name.front() != '/') {
+        return "/" + name;
+    }
+
+    return name;
+}
+
+std::string
+snapshotName(const std::string &name, std::uint64_t generation)
+{
+    return segmentName(name) + "." + std::to_string(generation);
+}
+
+#ifndef _WIN32
+
+// Map the whole segment at `name`, returns nullptr on failure
+void *
+mapSegment(const std::string &name, bool writable, std::size_t &size,
+           bool create = false)
+{
+    int flags = writable ? O_RDWR : O_RDONLY;
+    if (create) {
+        flags |= O_CREAT;
+    }
+
+    int fd = ::shm_open(name.c_str(), flags, 0644);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    if (create) {
+        if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            ::close(fd);
+            return nullptr;
+        }
+    } else {
+        struct stat st {};
+        if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+            ::close(fd);
+            return nullptr;
+        }
+        size = static_cast<std::size_t>(st.st_size);
+    }
+
+    void *address =
+        ::mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+               MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (address == MAP_FAILED) {
+        return nullptr;
+    }
+
+    return address;
+}
+
+#endif
+
+}  // namespace
+
+#ifndef _WIN32
+
+SharedSnapshotPublisher::SharedSnapshotPublisher(
+    std::shared_ptr<SettingManager> _owner, std::string _name,
+    bool publishOnChange, std::chrono::milliseconds _publishDelay)
+    : owner(std::move(_owner))
+    , name(std::move(_name))
+    , publishDelay(_publishDelay)
+    , pending(std::make_shared<PendingPublish>())
+{
+    this->pending->publisher = this;
+
+    std::size_t size = sizeof(Control);
+    this->control = mapSegment(segmentName(this->name), true, size, true);
+    if (this->control == nullptr) {
+        return;
+    }
+
+    // Continue where a previous owner left off, so readers notice the change
+    this->currentGeneration =
+        static_cast<Control *>(this->control)->generation.load();
+
+    this->publish();
+
+    if (publishOnChange) {
+        this->updatedConnection = this->owner->updated.connect(
+            [this](const auto &, const auto &, const auto &args) {
+                if (args.writeToFile) {
+                    this->schedulePublish();
+                }
+            });
+    }
+}
+
+SharedSnapshotPublisher::~SharedSnapshotPublisher()
+{
+    this->updatedConnection.disconnect();
+
+    {
+        // Waits for a scheduled publish that's running right now
+        std::lock_guard<std::mutex> lock(this->pending->mutex);
+        this->pending->publisher = nullptr;
+    }
+
+    if (this->control == nullptr) {
+        return;
+    }
+
+    ::munmap(this->control, sizeof(Control));
+
+    // Readers keep their mappings, but nobody can pick these up anymore
+    ::shm_unlink(snapshotName(this->name, this->currentGeneration).c_str());
+    ::shm_unlink(segmentName(this->name).c_str());
+}
+
+bool
+SharedSnapshotPublisher::publish()
+{
+    if (this->control == nullptr) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    // Flattened without holding the document of our owner
+    rapidjson::Document current;
+    if (!this->owner->getCopy("", current)) {
+        return false;
+    }
+
+    std::vector<FlatValue> values;
+    std::string path;
+    flatten(current, path, values);
+
+    std::sort(values.begin(), values.end(), [](const auto &a, const auto &b) {
+        return detail::pointerLess(a.path, b.path);
+    });
+
+    auto stringsOffset =
+        sizeof(SnapshotHeader) + values.size() * sizeof(SnapshotEntry);
+    auto size = stringsOffset;
+    for (const auto &value : values) {
+        size += value.path.size() + value.json.size();
+    }
+
+    auto generation = this->currentGeneration + 1;
+    auto segment = snapshotName(this->name, generation);
+
+    auto *address = static_cast<char *>(mapSegment(segment, true, size, true));
+    if (address == nullptr) {
+        return false;
+    }
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.generation = generation;
+    header.entryCount = values.size();
+    header.size = size;
+    std::memcpy(address, &header, sizeof(header));
+
+    auto *entries = address + sizeof(SnapshotHeader);
+    auto offset = stringsOffset;
+    for (const auto &value : values) {
+        SnapshotEntry entry{
+            .pathOffset = offset,
+            .pathLength = value.path.size(),
+            .valueOffset = offset + value.path.size(),
+            .valueLength = value.json.size(),
+        };
+        std::memcpy(entries, &entry, sizeof(entry));
+        entries += sizeof(entry);
+
+        std::memcpy(address + offset, value.path.data(), value.path.size());
+        offset += value.path.size();
+        std::memcpy(address + offset, value.json.data(), value.json.size());
+        offset += value.json.size();
+    }
+
+    ::munmap(address, size);
+
+    static_cast<Control *>(this->control)
+        ->generation.store(generation, std::memory_order_release);
+
+    // Readers still using the previous generation keep their mapping
+    ::shm_unlink(snapshotName(this->name, this->currentGeneration).c_str());
+
+    this->currentGeneration = generation;
+
+    return true;
+}
+
+void
+SharedSnapshotPublisher::schedulePublish()
+{
+    // Publishing copies the whole document, so it's done once for all values
+    // set within `publishDelay` and not on the thread that set them
+    if (this->pending->scheduled.load(std::memory_order_relaxed) ||
+        this->pending->scheduled.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+
+    std::weak_ptr<PendingPublish> weakPending = this->pending;
+    detail::TimerWheel::instance().schedule(this->publishDelay, [weakPending] {
+        auto pending = weakPending.lock();
+        if (!pending) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(pending->mutex);
+
+        // Values set while we publish are picked up by the next publish
+        pending->scheduled.store(false, std::memory_order_release);
+        if (pending->publisher != nullptr) {
+            pending->publisher->publish();
+        }
+    });
+}
+
+std::uint64_t
+SharedSnapshotPublisher::generation() const
+{
+    return this->currentGeneration;
+}
+
+SharedSnapshotReader::SharedSnapshotReader(std::string _name)
+    : name(std::move(_name))
+{
+}
+
+SharedSnapshotReader::~SharedSnapshotReader()
+{
+    this->unmapSnapshot();
+
+    if (this->control != nullptr) {
+        ::munmap(this->control, sizeof(Control));
+    }
+}
+
+bool
+SharedSnapshotReader::refresh()
+{
+    if (this->control == nullptr) {
+        std::size_t size = 0;
+        this->control = mapSegment(segmentName(this->name), false, size);
+        if (this->control == nullptr || size < sizeof(Control)) {
+            return false;
+        }
+    }
+
+    auto generation = static_cast<const Control *>(this->control)
+                          ->generation.load(std::memory_order_acquire);
+    if (generation == this->snapshotGeneration) {
+        return this->snapshot != nullptr;
+    }
+
+    std::size_t size = 0;
+    auto *address = static_cast<const char *>(
+        mapSegment(snapshotName(this->name, generation), false, size));
+    if (address == nullptr) {
+        // The publisher has moved on already, try again next time
+        return this->snapshot != nullptr;
+    }
+
+    SnapshotHeader header{};
+    if (size < sizeof(header)) {
+        ::munmap(const_cast<char *>(address), size);
+        return this->snapshot != nullptr;
+    }
+
+    std::memcpy(&header, address, sizeof(header));
+    if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) !=
+            0 ||
+        header.size > size ||
+        header.entryCount >
+            (size - sizeof(header)) / sizeof(SnapshotEntry)) {
+        ::munmap(const_cast<char *>(address), size);
+        return this->snapshot != nullptr;
+    }
+
+    this->unmapSnapshot();
+
+    this->snapshot = address;
+    this->snapshotSize = size;
+    this->snapshotGeneration = generation;
+
+    return true;
+}
+
+void
+SharedSnapshotReader::unmapSnapshot()
+{
+    if (this->snapshot != nullptr) {
+        ::munmap(const_cast<char *>(this->snapshot), this->snapshotSize);
+        this->snapshot = nullptr;
+        this->snapshotSize = 0;
+    }
+}
+
+#else
+
+SharedSnapshotPublisher::SharedSnapshotPublisher(
+    std::shared_ptr<SettingManager> _owner, std::string _name,
+    bool /*publishOnChange*/, std::chrono::milliseconds _publishDelay)
+    : owner(std::move(_owner))
+    , name(std::move(_name))
+    , publishDelay(_publishDelay)
+{
+}
+
+SharedSnapshotPublisher::~SharedSnapshotPublisher() = default;
+
+bool
+SharedSnapshotPublisher::publish()
+{
+    return false;
+}
+
+std::uint64_t
+SharedSnapshotPublisher::generation() const
+{
+    return this->currentGeneration;
+}
+
+SharedSnapshotReader::SharedSnapshotReader(std::string _name)
+    : name(std::move(_name))
+{
+}
+
+SharedSnapshotReader::~SharedSnapshotReader() = default;
+
+bool
+SharedSnapshotReader::refresh()
+{
+    return false;
+}
+
+void
+SharedSnapshotReader::unmapSnapshot()
+{
+}
+
+#endif
+
+std::uint64_t
+SharedSnapshotReader::generation() const
+{
+    return this->snapshotGeneration;
+}
+
+bool
+SharedSnapshotReader::getJSON(const std::string &path,
+                              rapidjson::Document &out) const
+{
+    if (this->snapshot == nullptr) {
+        return false;
+    }
+
+    // The segment can be changed by whoever else can open it, so everything
+    // read from it is checked against the size of our mapping again
+    SnapshotHeader header{};
+    std::memcpy(&header, this->snapshot, sizeof(header));
+    if (header.entryCount > (this->snapshotSize - sizeof(header)) /
+                                sizeof(SnapshotEntry)) {
+        return false;
+    }
+
+    auto entryAt = [this](std::size_t i) {
+        SnapshotEntry entry{};
+        std::memcpy(&entry,
+                    this->snapshot + sizeof(SnapshotHeader) +
+                        i * sizeof(SnapshotEntry),
+                    sizeof(entry));
+        return entry;
+    };
+    auto stringAt = [this](std::uint64_t offset, std::uint64_t length)
+        -> std::optional<std::string_view> {
+        if (offset > this->snapshotSize ||
+            length > this->snapshotSize - offset) {
+            return std::nullopt;
+        }
+
+        return std::string_view(this->snapshot + offset, length);
+    };
+    auto pathOf = [&stringAt](const SnapshotEntry &entry) {
+        return stringAt(entry.pathOffset, entry.pathLength);
+    };
+    auto valueOf = [&stringAt](const SnapshotEntry &entry) {
+        return stringAt(entry.valueOffset, entry.valueLength);
+    };
+
+    // Binary search for `path`
+    std::size_t lo = 0;
+    std::size_t hi = header.entryCount;
+    while (lo < hi) {
+        auto mid = lo + (hi - lo) / 2;
+        auto midPath = pathOf(entryAt(mid));
+        if (!midPath) {
+            return false;
+        }
+
+        if (detail::pointerLess(*midPath, path)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo == header.entryCount) {
+        return false;
+    }
+
+    auto foundPath = pathOf(entryAt(lo));
+    if (!foundPath || *foundPath != path) {
+        return false;
+    }
+
+    auto parseInto = [](std::string_view json, rapidjson::Document &document) {
+        return !document.Parse(json.data(), json.size()).HasParseError();
+    };
+
+    auto root = valueOf(entryAt(lo));
+    if (!root) {
+        return false;
+    }
+
+    if (*root != "{}" && *root != "[]") {
+        return parseInto(*root, out);
+    }
+
+    if (*root == "{}") {
+        out.SetObject();
+    } else {
+        out.SetArray();
+    }
+
+    // The subtree follows right after its root
+    for (auto i = lo + 1; i < header.entryCount; ++i) {
+        auto entry = entryAt(i);
+        auto childPath = pathOf(entry);
+        auto json = valueOf(entry);
+        if (!childPath || !json) {
+            return false;
+        }
+
+        if (!detail::isSameOrChild(*childPath, path)) {
+            break;
+        }
+
+        std::string relativePath(childPath->substr(path.size()));
+
+        rapidjson::Document child;
+        if (*json == "{}") {
+            child.SetObject();
+        } else if (*json == "[]") {
+            child.SetArray();
+        } else if (!parseInto(*json, child)) {
+            return false;
+        }
+
+        rapidjson::Pointer(relativePath.c_str())
+            .Set(out, static_cast<const rapidjson::Value &>(child));
+    }
+
+    return true;
+}
+
+}  // namespace pajlada::Settings
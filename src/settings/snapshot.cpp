@@ -0,0 +1,51 @@
+#include <pajlada/settings/detail/persistenttree.hpp>
+#include <pajlada/settings/snapshot.hpp>
+
+namespace pajlada::Settings {
+
+Snapshot::Snapshot(std::shared_ptr<const detail::PersistentNode> _root,
+                   std::uint64_t version)
+    : root(std::move(_root))
+    , documentVersion(version)
+{
+}
+
+bool
+Snapshot::empty() const
+{
+    return this->root == nullptr ||
+           (this->root->type == rapidjson::kObjectType &&
+            this->root->members.empty());
+}
+
+std::uint64_t
+Snapshot::version() const
+{
+    return this->documentVersion;
+}
+
+bool
+Snapshot::getJSON(const std::string &path, rapidjson::Document &out) const
+{
+    const auto *node = detail::findPersistent(this->root, path);
+    if (node == nullptr) {
+        return false;
+    }
+
+    detail::copyPersistent(*node, out, out.GetAllocator());
+
+    return true;
+}
+
+void
+Snapshot::toDocument(rapidjson::Document &out) const
+{
+    if (this->root == nullptr) {
+        out.SetObject();
+        return;
+    }
+
+    detail::copyPersistent(*this->root, out, out.GetAllocator());
+}
+
+}  // namespace pajlada::Settings
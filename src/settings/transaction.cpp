@@ -0,0 +1,68 @@
+#include <algorithm>
+#include <pajlada/settings/transaction.hpp>
+
+namespace pajlada::Settings {
+
+Transaction::Transaction()
+    : manager(*SettingManager::getInstance())
+{
+}
+
+Transaction::Transaction(SettingManager &_manager)
+    : manager(_manager)
+{
+}
+
+void
+Transaction::set(const std::string &path, const rapidjson::Value &value,
+                 SignalArgs args)
+{
+    if (args.source == SignalArgs::Source::Unset) {
+        args.source = SignalArgs::Source::Setter;
+    }
+
+    for (auto &write : this->writes) {
+        if (write.path == path) {
+            write.value.CopyFrom(value, write.value.GetAllocator());
+            write.args = std::move(args);
+            write.storeLocally = nullptr;
+            return;
+        }
+    }
+
+    Write write;
+    write.path = path;
+    write.value.CopyFrom(value, write.value.GetAllocator());
+    write.args = std::move(args);
+
+    this->writes.push_back(std::move(write));
+}
+
+Transaction::Write &
+Transaction::findWrite(const std::string &path)
+{
+    return *std::find_if(this->writes.begin(), this->writes.end(),
+                         [&path](const auto &write) {
+                             return write.path == path;
+                         });
+}
+
+bool
+Transaction::commit()
+{
+    return this->manager.commit(*this);
+}
+
+void
+Transaction::discard()
+{
+    this->writes.clear();
+}
+
+bool
+Transaction::empty() const
+{
+    return this->writes.empty();
+}
+
+}  // namespace pajlada::Settings
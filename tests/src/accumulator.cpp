@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+
+#include <pajlada/settings.hpp>
+#include <pajlada/settings/accumulator.hpp>
+#include <pajlada/settings/backend.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace pajlada::Settings;
+
+namespace {
+
+class NullBackend : public Backend
+{
+public:
+    LoadError
+    load(const std::filesystem::path & /*path*/,
+         rapidjson::Document & /*document*/) override
+    {
+        return LoadError::NoError;
+    }
+
+    bool
+    persist(const std::filesystem::path & /*path*/,
+            const rapidjson::Document &document,
+            const PersistRequest & /*request*/) override
+    {
+        ++this->persists;
+
+        const auto *value = rapidjson::Pointer("/stats/messages").Get(document);
+        this->persistedMessages = value != nullptr ? value->GetInt64() : 0;
+
+        return true;
+    }
+
+    int persists = 0;
+    std::int64_t persistedMessages = 0;
+};
+
+}  // namespace
+
+TEST(Accumulator, Fold)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    Setting<std::int64_t> messages("/stats/messages", SettingOption::Default,
+                                   sm);
+    Accumulator<std::int64_t> accumulator("/stats/messages", sm);
+
+    int notifications = 0;
+    std::vector<std::unique_ptr<pajlada::Signals::ScopedConnection>>
+        connections;
+    messages.connect(
+        [&](std::int64_t, const SignalArgs &) {
+            ++notifications;
+        },
+        connections, false);
+
+    constexpr int numThreads = 4;
+    constexpr int numAdds = 10000;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; ++i) {
+        threads.emplace_back([&] {
+            for (int j = 0; j < numAdds; ++j) {
+                ++accumulator;
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(accumulator.get(), numThreads * numAdds);
+    EXPECT_EQ(messages.getValue(), 0);
+    EXPECT_EQ(notifications, 0);
+
+    accumulator.fold();
+
+    EXPECT_EQ(messages.getValue(), numThreads * numAdds);
+    EXPECT_EQ(accumulator.get(), numThreads * numAdds);
+    EXPECT_EQ(notifications, 1);
+
+    // Nothing pending
+    accumulator.fold();
+    EXPECT_EQ(notifications, 1);
+}
+
+TEST(Accumulator, FoldOnSave)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveOnSettingChange;
+
+    auto backend = std::make_unique<NullBackend>();
+    auto *nullBackend = backend.get();
+    sm->setBackend(std::move(backend));
+
+    Accumulator<std::int64_t> accumulator("/stats/messages", sm);
+
+    accumulator += 5;
+    accumulator += 7;
+    EXPECT_EQ(nullBackend->persists, 0);
+
+    sm->save();
+
+    // The fold doesn't cause a save of its own
+    EXPECT_EQ(nullBackend->persists, 1);
+    EXPECT_EQ(nullBackend->persistedMessages, 12);
+}
+
+TEST(Accumulator, FlushInterval)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    Setting<int> bytes("/stats/bytes", SettingOption::Default, sm);
+    Accumulator<int> accumulator("/stats/bytes", sm,
+                                 std::chrono::milliseconds(10));
+
+    accumulator.add(100);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (bytes.getValue() != 100 &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    EXPECT_EQ(bytes.getValue(), 100);
+}
+
+TEST(Accumulator, ReadsDuringFolds)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    Setting<std::int64_t> messages("/stats/messages", SettingOption::Default,
+                                   sm);
+    Accumulator<std::int64_t> accumulator("/stats/messages", sm);
+
+    // A notification of the fold sees the folded value
+    std::int64_t notified = -1;
+    std::vector<std::unique_ptr<pajlada::Signals::ScopedConnection>>
+        connections;
+    messages.connect(
+        [&](std::int64_t value, const SignalArgs &) {
+            notified = accumulator.get();
+            EXPECT_GE(notified, value);
+        },
+        connections, false);
+
+    constexpr int numAdds = 100000;
+
+    std::atomic<bool> done{false};
+    std::thread adder([&] {
+        for (int i = 0; i < numAdds; ++i) {
+            ++accumulator;
+        }
+        done = true;
+    });
+    std::thread folder([&] {
+        while (!done) {
+            accumulator.fold();
+        }
+    });
+
+    std::int64_t last = 0;
+    while (!done) {
+        auto value = accumulator.get();
+        if (value < last || value > numAdds) {
+            ADD_FAILURE() << "read " << value << " after " << last;
+            break;
+        }
+        last = value;
+    }
+
+    adder.join();
+    folder.join();
+
+    EXPECT_EQ(accumulator.get(), numAdds);
+    accumulator.fold();
+    EXPECT_EQ(messages.getValue(), numAdds);
+    EXPECT_EQ(notified, numAdds);
+}
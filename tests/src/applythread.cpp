@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+
+#include <pajlada/settings.hpp>
+
+#include "common.hpp"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace pajlada::Settings;
+
+TEST(ApplyThread, Flush)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+    sm->setApplyThreadEnabled();
+
+    constexpr int numThreads = 4;
+    constexpr int numWrites = 1000;
+
+    std::vector<std::unique_ptr<Setting<int>>> settings;
+    for (int i = 0; i < numThreads; ++i) {
+        settings.push_back(std::make_unique<Setting<int>>(
+            "/apply/" + std::to_string(i), SettingOption::Default, sm));
+    }
+
+    std::vector<std::thread> writers;
+    for (int i = 0; i < numThreads; ++i) {
+        writers.emplace_back([&, i] {
+            for (int j = 1; j <= numWrites; ++j) {
+                EXPECT_TRUE(settings[i]->setValue(j));
+            }
+
+            sm->flush();
+
+            // Our own writes are applied in order
+            rapidjson::Document value;
+            ASSERT_TRUE(
+                sm->getCopy(("/apply/" + std::to_string(i)).c_str(), value));
+            EXPECT_EQ(value.GetInt(), numWrites);
+        });
+    }
+    for (auto &writer : writers) {
+        writer.join();
+    }
+
+    for (const auto &setting : settings) {
+        EXPECT_EQ(setting->getValue(), numWrites);
+    }
+}
+
+TEST(ApplyThread, Notifications)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    Setting<int> a("/apply/a", SettingOption::Default, sm);
+
+    std::thread::id notifiedOn;
+    int lastValue = 0;
+    std::vector<std::unique_ptr<pajlada::Signals::ScopedConnection>>
+        connections;
+    a.connect(
+        [&](int value, const SignalArgs &) {
+            notifiedOn = std::this_thread::get_id();
+            lastValue = value;
+
+            // Must not wait for itself
+            sm->flush();
+        },
+        connections, false);
+
+    sm->setApplyThreadEnabled();
+
+    a = 1;
+    a = 2;
+    sm->flush();
+
+    EXPECT_EQ(lastValue, 2);
+    EXPECT_NE(notifiedOn, std::this_thread::get_id());
+
+    sm->setApplyThreadEnabled(false);
+
+    a = 3;
+    EXPECT_EQ(lastValue, 3);
+    EXPECT_EQ(notifiedOn, std::this_thread::get_id());
+}
+
+// Meant to be run with PAJLADA_SETTINGS_SANITIZE_THREAD
+TEST(ApplyThread, ReadsDuringWrites)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+    sm->setApplyThreadEnabled();
+
+    constexpr int numWrites = 2000;
+    constexpr int numReaders = 3;
+
+    std::atomic<bool> done{false};
+
+    std::thread writer([&] {
+        Setting<int> a("/apply/reads/a", SettingOption::Default, sm);
+        Setting<std::vector<int>> b("/apply/reads/b", SettingOption::Default,
+                                    sm);
+
+        for (int i = 1; i <= numWrites; ++i) {
+            a = i;
+            // Values of different sizes, so the document reallocates them
+            b = std::vector<int>(i % 16, i);
+        }
+
+        sm->flush();
+        done = true;
+    });
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < numReaders; ++i) {
+        readers.emplace_back([&] {
+            Setting<int> a("/apply/reads/a", SettingOption::Default, sm);
+            Setting<std::vector<int>> b("/apply/reads/b",
+                                        SettingOption::Default, sm);
+
+            while (!done) {
+                auto value = a.getValue();
+                EXPECT_GE(value, 0);
+                EXPECT_LE(value, numWrites);
+
+                // Never half of one write and half of another
+                auto values = b.getValue();
+                for (auto v : values) {
+                    EXPECT_EQ(v, values.front());
+                }
+
+                rapidjson::Document copy;
+                if (sm->getCopy("/apply/reads", copy)) {
+                    EXPECT_TRUE(copy.IsObject());
+                }
+            }
+        });
+    }
+
+    std::thread saver([&] {
+        while (!done) {
+            EXPECT_NE(SaveFile("out.applythread.json", sm.get()),
+                      SettingManager::SaveResult::Failed);
+            sm->snapshot();
+        }
+    });
+
+    writer.join();
+    for (auto &reader : readers) {
+        reader.join();
+    }
+    saver.join();
+
+    Setting<int> a("/apply/reads/a", SettingOption::Default, sm);
+    EXPECT_EQ(a.getValue(), numWrites);
+}
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+
+#include <pajlada/settings.hpp>
+#include <pajlada/settings/backend.hpp>
+
+#include "common.hpp"
+
+#include <chrono>
+#include <future>
+#include <thread>
+
+using namespace pajlada::Settings;
+using SaveResult = pajlada::Settings::SettingManager::SaveResult;
+
+namespace {
+
+class MemoryBackend : public Backend
+{
+public:
+    LoadError
+    load(const std::filesystem::path & /*path*/,
+         rapidjson::Document &document) override
+    {
+        document.Parse(R"({"a": 1, "b": {"c": 2}})");
+
+        return LoadError::NoError;
+    }
+
+    bool
+    persist(const std::filesystem::path & /*path*/,
+            const rapidjson::Document & /*document*/,
+            const PersistRequest &request) override
+    {
+        this->requests.push_back(request);
+
+        return true;
+    }
+
+    std::vector<PersistRequest> requests;
+};
+
+// Blocks in persist until `release` is set
+class BlockingBackend : public Backend
+{
+public:
+    LoadError
+    load(const std::filesystem::path & /*path*/,
+         rapidjson::Document & /*document*/) override
+    {
+        return LoadError::NoError;
+    }
+
+    bool
+    persist(const std::filesystem::path & /*path*/,
+            const rapidjson::Document &document,
+            const PersistRequest & /*request*/) override
+    {
+        this->entered.set_value();
+        this->release.get_future().wait();
+
+        const auto *a = rapidjson::Pointer("/a").Get(document);
+        this->persistedA = a != nullptr ? a->GetInt() : 0;
+
+        return true;
+    }
+
+    std::promise<void> entered;
+    std::promise<void> release;
+    int persistedA = 0;
+};
+
+}  // namespace
+
+TEST(Backend, IncrementalPersist)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    auto backend = std::make_unique<MemoryBackend>();
+    auto *memoryBackend = backend.get();
+    sm->setBackend(std::move(backend));
+
+    EXPECT_EQ(SettingManager::LoadError::NoError, sm->load("memory"));
+
+    Setting<int> a("/a", SettingOption::Default, sm);
+    Setting<int> c("/b/c", SettingOption::Default, sm);
+
+    EXPECT_EQ(a.getValue(), 1);
+    EXPECT_EQ(c.getValue(), 2);
+
+    c = 3;
+    c = 4;
+
+    EXPECT_EQ(SaveResult::Success, sm->save());
+
+    ASSERT_EQ(memoryBackend->requests.size(), 1);
+    EXPECT_FALSE(memoryBackend->requests[0].full);
+    EXPECT_EQ(memoryBackend->requests[0].dirtyPaths,
+              std::vector<std::string>{"/b/c"});
+
+    EXPECT_EQ(SaveResult::Success, sm->save());
+
+    ASSERT_EQ(memoryBackend->requests.size(), 2);
+    EXPECT_FALSE(memoryBackend->requests[1].full);
+    EXPECT_TRUE(memoryBackend->requests[1].dirtyPaths.empty());
+
+    // Saving somewhere else needs the full document
+    EXPECT_EQ(SaveResult::Success, sm->saveAs("memory2"));
+
+    ASSERT_EQ(memoryBackend->requests.size(), 3);
+    EXPECT_TRUE(memoryBackend->requests[2].full);
+}
+
+TEST(Backend, SetsDuringPersist)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    auto backend = std::make_unique<BlockingBackend>();
+    auto *blockingBackend = backend.get();
+    sm->setBackend(std::move(backend));
+
+    Setting<int> a("/a", SettingOption::Default, sm);
+    a = 1;
+
+    auto entered = blockingBackend->entered.get_future();
+    std::thread saver([&] {
+        EXPECT_EQ(SaveResult::Success, sm->save("blocking"));
+    });
+    entered.wait();
+
+    // The document isn't held while the backend writes it out
+    auto set = std::async(std::launch::async, [&] {
+        a = 2;
+        return a.getValue();
+    });
+    EXPECT_EQ(set.wait_for(std::chrono::seconds(5)),
+              std::future_status::ready);
+
+    blockingBackend->release.set_value();
+    saver.join();
+    EXPECT_EQ(set.get(), 2);
+
+    // The save wrote the document as it was when the save started
+    EXPECT_EQ(blockingBackend->persistedA, 1);
+}
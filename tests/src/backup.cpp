@@ -244,3 +244,280 @@ TEST(Backup, Failing)
     EXPECT_TRUE(fs::exists("files/out.backup.failing.json.bkp-2"));
     EXPECT_TRUE(!fs::exists("files/out.backup.failing.json.bkp-3"));
 }
+
+TEST(Backup, Ring)
+{
+    Backup::Options options{
+        .enabled = true,
+        .numSlots = 3,
+        .rotation = Backup::Rotation::Ring,
+    };
+
+    auto doSave = [&](const std::string &contents) {
+        std::error_code ec;
+        Backup::saveWithBackup(
+            "files/out.backup.ring.json", options,
+            [&](const auto &path, auto &ec) {
+                std::ofstream of(path, std::ios::out);
+                if (!of) {
+                    ec = std::make_error_code(std::errc::io_error);
+                    return;
+                }
+                of << contents;
+            },
+            ec);
+        return !ec;
+    };
+
+    RemoveFile("files/out.backup.ring.json");
+    RemoveFile("files/out.backup.ring.json.bkp-1");
+    RemoveFile("files/out.backup.ring.json.bkp-2");
+    RemoveFile("files/out.backup.ring.json.bkp-3");
+    RemoveFile("files/out.backup.ring.json.bkp-index");
+
+    EXPECT_TRUE(doSave("1"));
+    EXPECT_TRUE(Backup::listBackups("files/out.backup.ring.json", options)
+                    .empty());
+
+    EXPECT_TRUE(doSave("2"));
+    EXPECT_TRUE(doSave("3"));
+    EXPECT_TRUE(doSave("4"));
+    EXPECT_TRUE(doSave("5"));
+
+    EXPECT_EQ(ReadFile("files/out.backup.ring.json"), "5");
+
+    auto backups = Backup::listBackups("files/out.backup.ring.json", options);
+    ASSERT_EQ(backups.size(), 3);
+    EXPECT_EQ(ReadFile(backups[0].string()), "4");
+    EXPECT_EQ(ReadFile(backups[1].string()), "3");
+    EXPECT_EQ(ReadFile(backups[2].string()), "2");
+
+    // The index is replaced through a temporary file
+    EXPECT_TRUE(!fs::exists("files/out.backup.ring.json.bkp-index.tmp"));
+    EXPECT_EQ(ReadFile("files/out.backup.ring.json.bkp-index"), "3");
+}
+
+TEST(Backup, RingContinuesShiftedBackups)
+{
+    Backup::Options options{
+        .enabled = true,
+        .numSlots = 3,
+        .rotation = Backup::Rotation::Ring,
+    };
+
+    RemoveFile("files/out.backup.ringmigrate.json.bkp-3");
+    RemoveFile("files/out.backup.ringmigrate.json.bkp-index");
+
+    // Layout left behind by a shift rotation
+    std::ofstream("files/out.backup.ringmigrate.json") << "current";
+    std::ofstream("files/out.backup.ringmigrate.json.bkp-1") << "newer";
+    std::ofstream("files/out.backup.ringmigrate.json.bkp-2") << "older";
+
+    std::error_code ec;
+    Backup::saveWithBackup(
+        "files/out.backup.ringmigrate.json", options,
+        [&](const auto &path, auto &) {
+            std::ofstream(path) << "new";
+        },
+        ec);
+    EXPECT_FALSE(ec);
+
+    auto backups =
+        Backup::listBackups("files/out.backup.ringmigrate.json", options);
+    ASSERT_EQ(backups.size(), 3);
+    EXPECT_EQ(ReadFile(backups[0].string()), "current");
+    EXPECT_EQ(ReadFile(backups[1].string()), "newer");
+    EXPECT_EQ(ReadFile(backups[2].string()), "older");
+}
+
+TEST(Backup, RingRecoversFromInterruptedRotation)
+{
+    Backup::Options options{
+        .enabled = true,
+        .numSlots = 3,
+        .rotation = Backup::Rotation::Ring,
+    };
+
+    auto doSave = [&](const std::string &contents) {
+        std::error_code ec;
+        Backup::saveWithBackup(
+            "files/out.backup.ringcrash.json", options,
+            [&](const auto &path, auto &) {
+                std::ofstream(path) << contents;
+            },
+            ec);
+        return !ec;
+    };
+
+    RemoveFile("files/out.backup.ringcrash.json");
+    RemoveFile("files/out.backup.ringcrash.json.bkp-1");
+    RemoveFile("files/out.backup.ringcrash.json.bkp-2");
+    RemoveFile("files/out.backup.ringcrash.json.bkp-3");
+    RemoveFile("files/out.backup.ringcrash.json.bkp-index");
+
+    EXPECT_TRUE(doSave("1"));
+    EXPECT_TRUE(doSave("2"));
+    EXPECT_EQ(ReadFile("files/out.backup.ringcrash.json.bkp-index"), "3");
+
+    // Crashed after pointing the index at the next slot, before moving the
+    // save into it
+    std::ofstream("files/out.backup.ringcrash.json.bkp-index") << "2";
+
+    auto backups =
+        Backup::listBackups("files/out.backup.ringcrash.json", options);
+    ASSERT_EQ(backups.size(), 1);
+    EXPECT_EQ(ReadFile(backups[0].string()), "1");
+
+    EXPECT_TRUE(doSave("3"));
+
+    backups = Backup::listBackups("files/out.backup.ringcrash.json", options);
+    ASSERT_EQ(backups.size(), 2);
+    EXPECT_EQ(ReadFile(backups[0].string()), "2");
+    EXPECT_EQ(ReadFile(backups[1].string()), "1");
+}
+
+TEST(Backup, Deltas)
+{
+    for (auto rotation : {Backup::Rotation::Shift, Backup::Rotation::Ring}) {
+        Backup::Options options{
+            .enabled = true,
+            .numSlots = 3,
+            .rotation = rotation,
+            .deltas = true,
+        };
+
+        RemoveFile("files/out.backup.deltas.json");
+        RemoveFile("files/out.backup.deltas.json.bkp-1");
+        RemoveFile("files/out.backup.deltas.json.bkp-2");
+        RemoveFile("files/out.backup.deltas.json.bkp-3");
+        RemoveFile("files/out.backup.deltas.json.bkp-index");
+
+        std::string base;
+        for (int i = 0; i < 1000; ++i) {
+            base += "    \"key" + std::to_string(i) + "\": true,\n";
+        }
+
+        std::vector<std::string> versions;
+        for (int i = 0; i < 5; ++i) {
+            auto contents = base + "    \"version\": " + std::to_string(i) +
+                            "\n";
+            versions.push_back(contents);
+
+            std::error_code ec;
+            Backup::saveWithBackup(
+                "files/out.backup.deltas.json", options,
+                [&](const auto &path, auto &) {
+                    std::ofstream(path, std::ios::binary) << contents;
+                },
+                ec);
+            EXPECT_FALSE(ec);
+        }
+
+        auto backups =
+            Backup::listBackups("files/out.backup.deltas.json", options);
+        ASSERT_EQ(backups.size(), 3);
+
+        // Only the newest backup is a full copy
+        EXPECT_EQ(ReadFile(backups[0].string()), versions[3]);
+        EXPECT_LT(fs::file_size(backups[1]), 128);
+        EXPECT_LT(fs::file_size(backups[2]), 128);
+
+        for (std::size_t age = 1; age <= 3; ++age) {
+            std::error_code ec;
+            auto contents = Backup::restoreBackup(
+                "files/out.backup.deltas.json", options, age, ec);
+            EXPECT_FALSE(ec);
+            EXPECT_EQ(contents, versions[4 - age]);
+        }
+
+        std::error_code ec;
+        Backup::restoreBackup("files/out.backup.deltas.json", options, 4, ec);
+        EXPECT_TRUE(ec);
+    }
+}
+
+TEST(Backup, Deferred)
+{
+    Backup::Options options{
+        .enabled = true,
+        .numSlots = 2,
+        .durability = Backup::Durability::SyncFileAndDirectory,
+    };
+
+    auto doSave = [&](const std::string &contents) {
+        std::error_code ec;
+        auto rotation = Backup::saveWithDeferredBackup(
+            "files/out.backup.deferred.json", options,
+            [&](const auto &path, auto &ec) {
+                std::ofstream of(path, std::ios::out);
+                if (!of) {
+                    ec = std::make_error_code(std::errc::io_error);
+                    return;
+                }
+                of << contents;
+            },
+            ec);
+        EXPECT_TRUE(!ec);
+
+        // The new contents are in place before the backups are rotated
+        EXPECT_EQ(ReadFile("files/out.backup.deferred.json"), contents);
+
+        if (rotation) {
+            rotation(ec);
+            EXPECT_TRUE(!ec);
+        }
+    };
+
+    RemoveFile("files/out.backup.deferred.json");
+    RemoveFile("files/out.backup.deferred.json.bkp-1");
+    RemoveFile("files/out.backup.deferred.json.bkp-2");
+
+    doSave("1");
+    EXPECT_TRUE(!fs::exists("files/out.backup.deferred.json.bkp-1"));
+
+    doSave("2");
+    doSave("3");
+
+    EXPECT_TRUE(!fs::exists("files/out.backup.deferred.json.tmp"));
+    EXPECT_EQ(ReadFile("files/out.backup.deferred.json"), "3");
+    EXPECT_EQ(ReadFile("files/out.backup.deferred.json.bkp-1"), "2");
+    EXPECT_EQ(ReadFile("files/out.backup.deferred.json.bkp-2"), "1");
+}
+
+#ifdef __linux__
+
+TEST(Backup, DeferredRotationError)
+{
+    using pajlada::Settings::Setting;
+    using pajlada::Settings::SettingManager;
+    using pajlada::Settings::SettingOption;
+
+    const std::string path = "files/out.backup.deferred-error.json";
+    RemoveFile(path);
+    fs::remove_all(path + ".bkp-1");
+
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+    sm->setBackupEnabled();
+    sm->setBackupSlots(1);
+    sm->setBackupDeferred();
+
+    Setting<int> a("/a", SettingOption::Default, sm);
+
+    a = 1;
+    EXPECT_EQ(SettingManager::SaveResult::Success, sm->saveAs(path));
+
+    // The previous save can't be moved into its backup slot
+    fs::create_directories(path + ".bkp-1/blocker");
+
+    a = 2;
+    EXPECT_EQ(SettingManager::SaveResult::Success, sm->saveAs(path));
+
+    EXPECT_FALSE(sm->getBackend().flush());
+    // Reported once
+    EXPECT_TRUE(sm->getBackend().flush());
+
+    fs::remove_all(path + ".bkp-1");
+}
+
+#endif
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+
+#include <pajlada/settings.hpp>
+#include <pajlada/settings/changefeed.hpp>
+
+#ifdef __linux__
+#include <poll.h>
+#endif
+
+using namespace pajlada::Settings;
+
+namespace {
+
+#ifdef __linux__
+bool
+isReadable(int fd)
+{
+    pollfd pfd{};
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+
+    return ::poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLIN) != 0;
+}
+#endif
+
+}  // namespace
+
+TEST(ChangeFeed, Drain)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    Setting<int> a("/feed/a", SettingOption::Default, sm);
+    Setting<int> b("/feed/b", SettingOption::Default, sm);
+
+    // Changes before the feed exists are not queued
+    a = 1;
+
+    auto &feed = sm->changeFeed();
+    EXPECT_TRUE(feed.drain().empty());
+
+#ifdef __linux__
+    ASSERT_GE(feed.fd(), 0);
+    EXPECT_FALSE(isReadable(feed.fd()));
+#endif
+
+    auto before = sm->currentSequence();
+
+    a = 2;
+    b = 3;
+    a = 4;
+
+#ifdef __linux__
+    EXPECT_TRUE(isReadable(feed.fd()));
+#endif
+
+    auto changes = feed.drain();
+    ASSERT_EQ(changes.size(), 3);
+    EXPECT_EQ(changes[0].path, "/feed/a");
+    EXPECT_EQ(changes[1].path, "/feed/b");
+    EXPECT_EQ(changes[2].path, "/feed/a");
+    EXPECT_EQ(changes[0].sequence, before + 1);
+    EXPECT_EQ(changes[1].sequence, before + 2);
+    EXPECT_EQ(changes[2].sequence, before + 3);
+    EXPECT_EQ(sm->currentSequence(), before + 3);
+
+#ifdef __linux__
+    EXPECT_FALSE(isReadable(feed.fd()));
+#endif
+
+    EXPECT_TRUE(feed.drain().empty());
+
+    b = 5;
+
+#ifdef __linux__
+    EXPECT_TRUE(isReadable(feed.fd()));
+#endif
+
+    changes = feed.drain();
+    ASSERT_EQ(changes.size(), 1);
+    EXPECT_EQ(changes[0].path, "/feed/b");
+}
@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+
+#include <pajlada/settings.hpp>
+#include <pajlada/settings/changelog.hpp>
+
+using namespace pajlada::Settings;
+
+TEST(ChangeLog, CatchUp)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    Setting<int> a("/log/a", SettingOption::Default, sm);
+    Setting<int> b("/log/b", SettingOption::Default, sm);
+
+    auto start = sm->currentSequence();
+
+    auto nothing = sm->changesSince(start);
+    EXPECT_FALSE(nothing.resyncNeeded);
+    EXPECT_TRUE(nothing.changes.empty());
+    EXPECT_EQ(nothing.sequence, start);
+
+    a = 1;
+    b = 2;
+
+    auto first = sm->changesSince(start);
+    EXPECT_FALSE(first.resyncNeeded);
+    ASSERT_EQ(first.changes.size(), 2);
+    EXPECT_EQ(first.changes[0].path, "/log/a");
+    EXPECT_EQ(first.changes[0].kind, Change::Kind::Set);
+    EXPECT_EQ(first.changes[1].path, "/log/b");
+    EXPECT_EQ(first.sequence, start + 2);
+
+    a = 3;
+
+    auto second = sm->changesSince(first.sequence);
+    ASSERT_EQ(second.changes.size(), 1);
+    EXPECT_EQ(second.changes[0].path, "/log/a");
+    EXPECT_EQ(second.changes[0].sequence, start + 3);
+}
+
+TEST(ChangeLog, Resync)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+    sm->setChangeLogCapacity(4);
+
+    Setting<int> a("/log/a", SettingOption::Default, sm);
+
+    auto start = sm->currentSequence();
+
+    for (int i = 0; i < 4; ++i) {
+        a = i;
+    }
+
+    // Exactly fits
+    auto all = sm->changesSince(start);
+    EXPECT_FALSE(all.resyncNeeded);
+    EXPECT_EQ(all.changes.size(), 4);
+
+    a = 4;
+
+    auto overflowed = sm->changesSince(start);
+    EXPECT_TRUE(overflowed.resyncNeeded);
+    EXPECT_TRUE(overflowed.changes.empty());
+    EXPECT_EQ(overflowed.sequence, sm->currentSequence());
+
+    // Resizing drops everything kept so far
+    auto before = sm->currentSequence();
+    sm->setChangeLogCapacity(8);
+    EXPECT_TRUE(sm->changesSince(before - 1).resyncNeeded);
+    EXPECT_FALSE(sm->changesSince(before).resyncNeeded);
+}
@@ -0,0 +1,326 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <pajlada/settings.hpp>
+#include <pajlada/settings/detail/strand.hpp>
+#include <thread>
+#include <vector>
+
+using namespace pajlada::Settings;
+
+namespace {
+
+// Collects posted tasks until they're run by hand
+class ManualExecutor
+{
+public:
+    Executor
+    executor()
+    {
+        return [this](std::function<void()> task) {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->tasks.push_back(std::move(task));
+        };
+    }
+
+    size_t
+    run()
+    {
+        std::vector<std::function<void()>> current;
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            current.swap(this->tasks);
+        }
+
+        for (auto &task : current) {
+            task();
+        }
+
+        return current.size();
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<std::function<void()>> tasks;
+};
+
+}  // namespace
+
+TEST(Executor, BatchesNotifications)
+{
+    auto sm = std::make_shared<SettingManager>();
+    Setting<int> setting("/executor/batch", SettingOption::Default, sm);
+
+    ManualExecutor executor;
+    std::vector<int> values;
+
+    ConnectionOptions options;
+    options.executor = executor.executor();
+    options.autoInvoke = false;
+    setting.connect(
+        [&](const int &value) {
+            values.push_back(value);
+        },
+        options);
+
+    setting = 1;
+    setting = 2;
+    setting = 3;
+
+    // Nothing is run on the setting thread
+    EXPECT_TRUE(values.empty());
+
+    // One task for the whole batch
+    EXPECT_EQ(1, executor.run());
+    EXPECT_EQ((std::vector<int>{1, 2, 3}), values);
+
+    setting = 4;
+    EXPECT_EQ(1, executor.run());
+    EXPECT_EQ((std::vector<int>{1, 2, 3, 4}), values);
+}
+
+TEST(Executor, Conflate)
+{
+    auto sm = std::make_shared<SettingManager>();
+    Setting<int> setting("/executor/conflate", SettingOption::Default, sm);
+
+    ManualExecutor executor;
+    std::vector<int> values;
+
+    ConnectionOptions options;
+    options.executor = executor.executor();
+    options.conflate = true;
+    setting.connect(
+        [&](const int &value, const SignalArgs &) {
+            values.push_back(value);
+        },
+        options);
+
+    setting = 1;
+    setting = 2;
+    setting = 3;
+
+    EXPECT_EQ(1, executor.run());
+    EXPECT_EQ((std::vector<int>{3}), values);
+}
+
+TEST(Executor, DisconnectDropsQueuedNotifications)
+{
+    auto sm = std::make_shared<SettingManager>();
+    Setting<int> setting("/executor/disconnect", SettingOption::Default, sm);
+
+    ManualExecutor executor;
+    int calls = 0;
+
+    {
+        Setting<int> listener("/executor/disconnect", SettingOption::Default,
+                              sm);
+        ConnectionOptions options;
+        options.executor = executor.executor();
+        options.autoInvoke = false;
+        listener.connectSimple(
+            [&](const SignalArgs &) {
+                ++calls;
+            },
+            options);
+
+        setting = 1;
+    }
+
+    executor.run();
+    EXPECT_EQ(0, calls);
+}
+
+TEST(Executor, ThreadPoolKeepsOrder)
+{
+    auto sm = std::make_shared<SettingManager>();
+    Setting<int> setting("/executor/pool", SettingOption::Default, sm);
+
+    std::atomic<int> last{0};
+    std::atomic<bool> inOrder{true};
+    std::atomic<bool> concurrent{false};
+    std::atomic<int> running{0};
+
+    {
+        ThreadPool pool(4);
+
+        ConnectionOptions options;
+        options.executor = pool.executor();
+        options.autoInvoke = false;
+        setting.connect(
+            [&](const int &value) {
+                if (running.fetch_add(1) != 0) {
+                    concurrent = true;
+                }
+                if (value != last + 1) {
+                    inOrder = false;
+                }
+                last = value;
+                running.fetch_sub(1);
+            },
+            options);
+
+        for (int i = 1; i <= 1000; ++i) {
+            setting = i;
+        }
+
+        // Wait for the pool to catch up before it goes away
+        while (last != 1000) {
+            std::this_thread::yield();
+        }
+    }
+
+    EXPECT_TRUE(inOrder);
+    EXPECT_FALSE(concurrent);
+    EXPECT_EQ(1000, last);
+}
+
+TEST(Executor, InlineStrandDoesNotRecurse)
+{
+    constexpr size_t count = 200000;
+
+    std::vector<int> delivered;
+    std::shared_ptr<detail::Strand<int>> strand;
+
+    // Without an executor, items pushed while delivering are delivered by
+    // the same drain
+    strand = detail::Strand<int>::create(Executor{}, false, [&](int &value) {
+        delivered.push_back(value);
+        if (delivered.size() < count) {
+            strand->push(value + 1);
+        }
+    });
+
+    strand->push(1);
+
+    ASSERT_EQ(count, delivered.size());
+    EXPECT_EQ(static_cast<int>(count), delivered.back());
+
+    strand->cancel();
+}
+
+namespace {
+
+// Values delivered to a rate-limited connection
+class Received
+{
+public:
+    void
+    push(int value)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->values.push_back(value);
+    }
+
+    std::vector<int>
+    get()
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->values;
+    }
+
+    // Wait until `count` values have been delivered, or give up after a while
+    std::vector<int>
+    waitFor(size_t count)
+    {
+        for (int i = 0; i < 200; ++i) {
+            auto current = this->get();
+            if (current.size() >= count) {
+                return current;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        return this->get();
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<int> values;
+};
+
+}  // namespace
+
+TEST(RateLimit, DebounceTrailing)
+{
+    auto sm = std::make_shared<SettingManager>();
+    Setting<int> setting("/ratelimit/trailing", SettingOption::Default, sm);
+
+    Received received;
+
+    ConnectionOptions options;
+    options.autoInvoke = false;
+    options.rateLimit = RateLimit::DebounceTrailing;
+    options.interval = std::chrono::milliseconds(50);
+    setting.connect(
+        [&](const int &value) {
+            received.push(value);
+        },
+        options);
+
+    for (int i = 1; i <= 100; ++i) {
+        setting = i;
+    }
+
+    EXPECT_TRUE(received.get().empty());
+    EXPECT_EQ((std::vector<int>{100}), received.waitFor(1));
+
+    // Nothing else is delivered
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ((std::vector<int>{100}), received.get());
+}
+
+TEST(RateLimit, DebounceLeading)
+{
+    auto sm = std::make_shared<SettingManager>();
+    Setting<int> setting("/ratelimit/leading", SettingOption::Default, sm);
+
+    Received received;
+
+    ConnectionOptions options;
+    options.autoInvoke = false;
+    options.rateLimit = RateLimit::DebounceLeading;
+    options.interval = std::chrono::milliseconds(50);
+    setting.connect(
+        [&](const int &value) {
+            received.push(value);
+        },
+        options);
+
+    for (int i = 1; i <= 100; ++i) {
+        setting = i;
+    }
+
+    EXPECT_EQ((std::vector<int>{1}), received.get());
+    EXPECT_EQ((std::vector<int>{1, 100}), received.waitFor(2));
+}
+
+TEST(RateLimit, Throttle)
+{
+    auto sm = std::make_shared<SettingManager>();
+    Setting<int> setting("/ratelimit/throttle", SettingOption::Default, sm);
+
+    Received received;
+    ThreadPool pool(1);
+
+    ConnectionOptions options;
+    options.executor = pool.executor();
+    options.autoInvoke = false;
+    options.rateLimit = RateLimit::Throttle;
+    options.interval = std::chrono::milliseconds(50);
+    setting.connect(
+        [&](const int &value) {
+            received.push(value);
+        },
+        options);
+
+    for (int i = 1; i <= 100; ++i) {
+        setting = i;
+    }
+
+    // The first value right away, the newest one once the interval is up
+    EXPECT_EQ((std::vector<int>{1, 100}), received.waitFor(2));
+}
@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+
+#include <pajlada/settings.hpp>
+#include <pajlada/settings/transaction.hpp>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace pajlada::Settings;
+
+TEST(Freeze, RejectsWrites)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    Setting<int> a("/freeze/a", SettingOption::Default, sm);
+    Setting<std::vector<int>> list("/freeze/list", SettingOption::Default,
+                                   sm);
+
+    a = 5;
+    list.push_back(1);
+
+    sm->freeze();
+    EXPECT_TRUE(sm->isFrozen());
+
+    EXPECT_FALSE(a.setValue(6));
+    EXPECT_EQ(a.getValue(), 5);
+    EXPECT_FALSE(sm->set("/freeze/b", rapidjson::Value(1)));
+    EXPECT_EQ(sm->get("/freeze/b"), nullptr);
+
+    list.push_back(2);
+    EXPECT_EQ(list.getValue(), std::vector<int>({1}));
+
+    Transaction transaction(*sm);
+    transaction.setValue(a, 7);
+    EXPECT_FALSE(transaction.commit());
+    EXPECT_FALSE(transaction.empty());
+    EXPECT_EQ(a.getValue(), 5);
+
+    EXPECT_EQ(sm->reload(), SettingManager::LoadError::Frozen);
+
+    sm->thaw();
+    EXPECT_FALSE(sm->isFrozen());
+
+    EXPECT_TRUE(transaction.commit());
+    EXPECT_EQ(a.getValue(), 7);
+
+    a = 8;
+    EXPECT_EQ(a.getValue(), 8);
+}
+
+TEST(Freeze, Reads)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    Setting<int> a("/freeze/a", SettingOption::Default, sm);
+    Setting<int> b("/freeze/b", 42, SettingOption::Default, sm);
+    a = 1;
+
+    sm->freeze();
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&] {
+            for (int j = 0; j < 10000; ++j) {
+                EXPECT_EQ(a.getValue(), 1);
+                EXPECT_EQ(b.getValue(), 42);
+            }
+        });
+    }
+    for (auto &reader : readers) {
+        reader.join();
+    }
+
+    // Found without registering anything
+    Setting<int> sameA("/freeze/a", SettingOption::Default, sm);
+    EXPECT_EQ(sameA.getValue(), 1);
+
+    // Registered once thawed
+    Setting<int> c("/freeze/c", SettingOption::Default, sm);
+    EXPECT_TRUE(c.isValid());
+
+    sm->thaw();
+
+    a = 2;
+    EXPECT_EQ(a.getValue(), 2);
+    EXPECT_EQ(sameA.getValue(), 2);
+
+    c = 3;
+    EXPECT_EQ(c.getValue(), 3);
+    EXPECT_TRUE(c.isValid());
+}
+
+TEST(Freeze, ManagersAreIndependent)
+{
+    auto first = std::make_shared<SettingManager>();
+    first->saveMethod = SettingManager::SaveMethod::SaveManually;
+    auto second = std::make_shared<SettingManager>();
+    second->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    Setting<int> a("/freeze/a", SettingOption::Default, first);
+    Setting<int> b("/freeze/a", SettingOption::Default, second);
+    a = 1;
+    b = 2;
+
+    first->freeze();
+    EXPECT_EQ(a.getValue(), 1);
+
+    // Only the first manager is frozen
+    second->freeze();
+    second->thaw();
+    EXPECT_TRUE(first->isFrozen());
+    EXPECT_FALSE(second->isFrozen());
+
+    EXPECT_EQ(a.getValue(), 1);
+    b = 3;
+    EXPECT_EQ(b.getValue(), 3);
+
+    first->thaw();
+    a = 4;
+    EXPECT_EQ(a.getValue(), 4);
+}
+
+TEST(Freeze, ThawWhileLookingUp)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    Setting<int> a("/freeze/lookup/a", SettingOption::Default, sm);
+    a = 1;
+
+    std::atomic<bool> done{false};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&] {
+            while (!done) {
+                // Looked up without the registry lock while frozen
+                Setting<int> lookup("/freeze/lookup/a", SettingOption::Default,
+                                    sm);
+                if (lookup.getValue() != 1) {
+                    done = true;
+                }
+            }
+        });
+    }
+
+    for (int i = 0; i < 200 && !done; ++i) {
+        sm->freeze();
+        // Created while frozen, registered by thaw
+        Setting<int> frozen("/freeze/lookup/frozen" + std::to_string(i),
+                            SettingOption::Default, sm);
+        sm->thaw();
+
+        // Inserted into the registry right after thawing
+        Setting<int> thawed("/freeze/lookup/thawed" + std::to_string(i),
+                            SettingOption::Default, sm);
+    }
+
+    bool failed = done.exchange(true);
+    for (auto &reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_FALSE(failed);
+    EXPECT_EQ(a.getValue(), 1);
+}
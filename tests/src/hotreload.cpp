@@ -0,0 +1,286 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <pajlada/settings.hpp>
+#include <pajlada/settings/backend.hpp>
+#include <pajlada/settings/jsonfilebackend.hpp>
+#include <thread>
+
+#include "common.hpp"
+
+using namespace pajlada::Settings;
+using SaveResult = pajlada::Settings::SettingManager::SaveResult;
+
+namespace {
+
+void
+WriteFile(const std::string &path, const std::string &contents)
+{
+    std::ofstream of(path, std::ios::out | std::ios::trunc);
+    of << contents;
+}
+
+class ScriptedBackend : public Backend
+{
+public:
+    LoadError
+    load(const std::filesystem::path & /*path*/,
+         rapidjson::Document &document) override
+    {
+        document.Parse(this->contents.c_str());
+
+        if (this->onLoad) {
+            this->onLoad();
+        }
+
+        return LoadError::NoError;
+    }
+
+    bool
+    persist(const std::filesystem::path & /*path*/,
+            const rapidjson::Document & /*document*/,
+            const PersistRequest &request) override
+    {
+        this->requests.push_back(request);
+
+        return true;
+    }
+
+    std::string contents;
+    // Runs after the file has been read, before it's swapped in
+    std::function<void()> onLoad;
+    std::vector<PersistRequest> requests;
+};
+
+}  // namespace
+
+TEST(HotReload, ReloadOnlyNotifiesChangedSettings)
+{
+    RemoveFile("files/out.hotreload.diff.json");
+
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+    sm->setPath("files/out.hotreload.diff.json");
+
+    Setting<int> a("/a", SettingOption::Default, sm);
+    Setting<int> b("/b", SettingOption::Default, sm);
+    Setting<int> c("/c", SettingOption::Default, sm);
+
+    a = 1;
+    b = 2;
+    c = 3;
+
+    EXPECT_EQ(SaveResult::Success, sm->save());
+
+    int aCalls = 0;
+    int bCalls = 0;
+    int cCalls = 0;
+    a.connect(
+        [&](int) {
+            ++aCalls;
+        },
+        false);
+    b.connect(
+        [&](int) {
+            ++bCalls;
+        },
+        false);
+    c.connect(
+        [&](int) {
+            ++cCalls;
+        },
+        false);
+
+    WriteFile("files/out.hotreload.diff.json", R"({"a": 1, "b": 5})");
+
+    EXPECT_EQ(SettingManager::LoadError::NoError, sm->reload());
+
+    EXPECT_EQ(aCalls, 0);
+    EXPECT_EQ(bCalls, 1);
+    EXPECT_EQ(b.getValue(), 5);
+
+    // Removed from the file
+    EXPECT_EQ(cCalls, 1);
+    EXPECT_TRUE(sm->get("/c") == nullptr);
+}
+
+TEST(HotReload, KeepsWritesMadeDuringReload)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    auto backend = std::make_unique<ScriptedBackend>();
+    auto *scripted = backend.get();
+    scripted->contents = R"({"a": 1, "b": 2})";
+    sm->setBackend(std::move(backend));
+
+    EXPECT_EQ(SettingManager::LoadError::NoError, sm->load("scripted"));
+
+    Setting<int> a("/a", SettingOption::Default, sm);
+    Setting<int> b("/b", SettingOption::Default, sm);
+
+    EXPECT_EQ(a.getValue(), 1);
+    EXPECT_EQ(b.getValue(), 2);
+
+    scripted->contents = R"({"a": 3, "b": 2})";
+    scripted->onLoad = [&] {
+        b = 7;
+    };
+
+    EXPECT_EQ(SettingManager::LoadError::NoError, sm->reload());
+
+    EXPECT_EQ(a.getValue(), 3);
+    // Written after the file was read, so newer than the file
+    EXPECT_EQ(b.getValue(), 7);
+
+    // ...and still to be saved
+    EXPECT_EQ(SaveResult::Success, sm->save());
+    ASSERT_FALSE(scripted->requests.empty());
+    EXPECT_FALSE(scripted->requests.back().full);
+    EXPECT_EQ(scripted->requests.back().dirtyPaths,
+              std::vector<std::string>{"/b"});
+}
+
+TEST(HotReload, EmptyFileIsNotReady)
+{
+    RemoveFile("files/out.hotreload.empty.json");
+
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+    sm->setPath("files/out.hotreload.empty.json");
+
+    Setting<int> a("/a", SettingOption::Default, sm);
+    a = 1;
+
+    EXPECT_EQ(SaveResult::Success, sm->save());
+
+    int calls = 0;
+    a.connect(
+        [&](int) {
+            ++calls;
+        },
+        false);
+
+    // Caught between another writer's truncate and its write
+    WriteFile("files/out.hotreload.empty.json", "");
+
+    EXPECT_EQ(SettingManager::LoadError::FileEmpty, sm->reload());
+    EXPECT_EQ(calls, 0);
+    EXPECT_EQ(a.getValue(), 1);
+
+    WriteFile("files/out.hotreload.empty.json", R"({"a": 2})");
+
+    EXPECT_EQ(SettingManager::LoadError::NoError, sm->reload());
+    EXPECT_EQ(calls, 1);
+    EXPECT_EQ(a.getValue(), 2);
+}
+
+#ifdef __linux__
+
+namespace {
+
+class SlowFileBackend : public JsonFileBackend
+{
+public:
+    bool
+    persist(const std::filesystem::path &path,
+            const rapidjson::Document &document,
+            const PersistRequest &request) override
+    {
+        bool persisted = JsonFileBackend::persist(path, document, request);
+
+        // The file is written, but the save isn't done yet
+        if (this->onPersisted) {
+            this->onPersisted();
+        }
+
+        return persisted;
+    }
+
+    std::function<void()> onPersisted;
+};
+
+}  // namespace
+
+TEST(HotReload, SlowSaveIsNotReloaded)
+{
+    RemoveFile("files/out.hotreload.slow.json");
+
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    auto backend = std::make_unique<SlowFileBackend>();
+    auto *slow = backend.get();
+    sm->setBackend(std::move(backend));
+    sm->setPath("files/out.hotreload.slow.json");
+
+    Setting<int> a("/a", SettingOption::Default, sm);
+    a = 1;
+
+    EXPECT_EQ(SaveResult::Success, sm->save());
+
+    EXPECT_TRUE(sm->setHotReloadEnabled(true, std::chrono::milliseconds(20)));
+
+    slow->onPersisted = [&] {
+        // Not saved yet, a reload of our own save would revert it
+        a = 3;
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    };
+
+    a = 2;
+    EXPECT_EQ(SaveResult::Success, sm->save());
+    slow->onPersisted = nullptr;
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_EQ(a.getValue(), 3);
+
+    sm->setHotReloadEnabled(false);
+}
+
+TEST(HotReload, ExternalWrite)
+{
+    RemoveFile("files/out.hotreload.watch.json");
+
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+    sm->setPath("files/out.hotreload.watch.json");
+
+    Setting<int> a("/a", SettingOption::Default, sm);
+    a = 1;
+
+    EXPECT_EQ(SaveResult::Success, sm->save());
+
+    std::atomic<int> calls = 0;
+    a.connect(
+        [&](int) {
+            ++calls;
+        },
+        false);
+
+    EXPECT_TRUE(sm->setHotReloadEnabled(true, std::chrono::milliseconds(20)));
+
+    auto waitForCalls = [&](int expected) {
+        for (int i = 0; i < 200 && calls < expected; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return calls.load();
+    };
+
+    // Our own saves are not reloaded
+    a = 2;
+    EXPECT_EQ(SaveResult::Success, sm->save());
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_EQ(calls, 1);
+
+    WriteFile("files/out.hotreload.watch.json", R"({"a": 3})");
+
+    EXPECT_EQ(waitForCalls(2), 2);
+    EXPECT_EQ(a.getValue(), 3);
+
+    sm->setHotReloadEnabled(false);
+}
+
+#endif
@@ -1,6 +1,12 @@
 #include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "common.hpp"
+#include "pajlada/settings/notificationbatch.hpp"
 #include "pajlada/settings/settinglistener.hpp"
 
 using namespace pajlada::Settings;
@@ -119,3 +125,104 @@ TEST(Listener, emptyCallback)
     a = 42;
     listener.invoke();
 }
+
+TEST(Listener, coalesceBatch)
+{
+    Setting<int> a("/listener/coalesce-batch/a");
+    Setting<int> b("/listener/coalesce-batch/b");
+
+    size_t invocations = 0;
+    std::vector<std::vector<std::string>> batches;
+    SettingListener listener([&] { invocations++; });
+    listener.setCoalescedCB([&](const std::vector<std::string> &paths) {
+        batches.push_back(paths);
+    });
+    listener.addSetting(a);
+    listener.addSetting(b);
+
+    // Without a batch, every change is its own batch
+    a = 1;
+    ASSERT_EQ(batches.size(), 1);
+    ASSERT_EQ(batches[0], std::vector<std::string>{a.getPath()});
+
+    {
+        NotificationBatch batch;
+        b = 2;
+        a = 2;
+        b = 3;
+
+        {
+            NotificationBatch nested;
+            a = 3;
+        }
+
+        ASSERT_EQ(batches.size(), 1);
+    }
+
+    ASSERT_EQ(invocations, 5);
+    ASSERT_EQ(batches.size(), 2);
+    ASSERT_EQ(batches[1],
+              (std::vector<std::string>{b.getPath(), a.getPath()}));
+}
+
+TEST(Listener, coalesceWindow)
+{
+    Setting<int> a("/listener/coalesce-window/a");
+    Setting<int> b("/listener/coalesce-window/b");
+
+    std::mutex mutex;
+    std::vector<std::vector<std::string>> batches;
+    SettingListener listener;
+    listener.setCoalescedCB(
+        [&](const std::vector<std::string> &paths) {
+            std::lock_guard<std::mutex> lock(mutex);
+            batches.push_back(paths);
+        },
+        std::chrono::milliseconds(20));
+    listener.addSetting(a);
+    listener.addSetting(b);
+
+    a = 1;
+    b = 1;
+    a = 2;
+
+    for (int i = 0; i < 200; ++i) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!batches.empty()) {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_EQ(batches.size(), 1);
+    ASSERT_EQ(batches[0],
+              (std::vector<std::string>{a.getPath(), b.getPath()}));
+}
+
+TEST(Listener, coalesceCallbackChangesSettings)
+{
+    Setting<int> a("/listener/coalesce-reentrant/a");
+    Setting<int> b("/listener/coalesce-reentrant/b");
+
+    std::vector<std::vector<std::string>> batches;
+    SettingListener listener;
+    listener.setCoalescedCB([&](const std::vector<std::string> &paths) {
+        batches.push_back(paths);
+
+        // Runs without the listener's locks, so this must not deadlock
+        if (paths.front() == a.getPath()) {
+            b = 1;
+        }
+    });
+    listener.addSetting(a);
+    listener.addSetting(b);
+
+    a = 1;
+
+    ASSERT_EQ(batches.size(), 2);
+    ASSERT_EQ(batches[0], std::vector<std::string>{a.getPath()});
+    ASSERT_EQ(batches[1], std::vector<std::string>{b.getPath()});
+}
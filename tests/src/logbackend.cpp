@@ -0,0 +1,199 @@
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <pajlada/settings.hpp>
+#include <pajlada/settings/logbackend.hpp>
+
+#include "common.hpp"
+
+using namespace pajlada::Settings;
+using SaveResult = pajlada::Settings::SettingManager::SaveResult;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::shared_ptr<SettingManager>
+makeManager(std::uint64_t compactionThreshold = 64 * 1024)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    auto backend = std::make_unique<LogBackend>();
+    backend->setCompactionThreshold(compactionThreshold);
+    sm->setBackend(std::move(backend));
+
+    return sm;
+}
+
+}  // namespace
+
+TEST(LogBackend, SaveAndLoad)
+{
+    RemoveFile("files/out.log.basic.json");
+
+    {
+        auto sm = makeManager();
+        sm->setPath("files/out.log.basic.json");
+
+        Setting<int> a("/a", SettingOption::Default, sm);
+        Setting<std::string> b("/b/c", SettingOption::Default, sm);
+
+        a = 5;
+        b = "forsen";
+
+        EXPECT_EQ(SaveResult::Success, sm->save());
+        auto fullSize = fs::file_size("files/out.log.basic.json");
+
+        a = 6;
+
+        EXPECT_EQ(SaveResult::Success, sm->save());
+
+        // Only a single small record has been appended
+        auto incrementalSize = fs::file_size("files/out.log.basic.json");
+        EXPECT_GT(incrementalSize, fullSize);
+        EXPECT_LT(incrementalSize - fullSize, 32);
+    }
+
+    {
+        auto sm = makeManager();
+
+        EXPECT_EQ(SettingManager::LoadError::NoError,
+                  sm->load("files/out.log.basic.json"));
+
+        Setting<int> a("/a", SettingOption::Default, sm);
+        Setting<std::string> b("/b/c", SettingOption::Default, sm);
+
+        EXPECT_EQ(a.getValue(), 6);
+        EXPECT_EQ(b.getValue(), "forsen");
+    }
+}
+
+TEST(LogBackend, RecoverFromTornWrite)
+{
+    RemoveFile("files/out.log.torn.json");
+
+    {
+        auto sm = makeManager();
+        sm->setPath("files/out.log.torn.json");
+
+        Setting<int> a("/a", SettingOption::Default, sm);
+
+        a = 5;
+        EXPECT_EQ(SaveResult::Success, sm->save());
+        a = 6;
+        EXPECT_EQ(SaveResult::Success, sm->save());
+    }
+
+    auto goodSize = fs::file_size("files/out.log.torn.json");
+
+    {
+        // Simulate a crash in the middle of writing a record
+        std::ofstream fh("files/out.log.torn.json",
+                         std::ios::binary | std::ios::app);
+        fh << "\x12\x34\x56";
+    }
+
+    {
+        auto sm = makeManager();
+
+        EXPECT_EQ(SettingManager::LoadError::NoError,
+                  sm->load("files/out.log.torn.json"));
+
+        Setting<int> a("/a", SettingOption::Default, sm);
+
+        EXPECT_EQ(a.getValue(), 6);
+        EXPECT_EQ(fs::file_size("files/out.log.torn.json"), goodSize);
+
+        a = 7;
+        EXPECT_EQ(SaveResult::Success, sm->save());
+    }
+
+    {
+        auto sm = makeManager();
+
+        EXPECT_EQ(SettingManager::LoadError::NoError,
+                  sm->load("files/out.log.torn.json"));
+
+        Setting<int> a("/a", SettingOption::Default, sm);
+
+        EXPECT_EQ(a.getValue(), 7);
+    }
+}
+
+TEST(LogBackend, Compaction)
+{
+    RemoveFile("files/out.log.compaction.json");
+
+    {
+        auto sm = makeManager(256);
+        sm->setPath("files/out.log.compaction.json");
+
+        Setting<int> a("/a", SettingOption::Default, sm);
+        Setting<int> b("/b", SettingOption::Default, sm);
+
+        b = 1;
+
+        for (int i = 0; i < 100; ++i) {
+            a = i;
+            EXPECT_EQ(SaveResult::Success, sm->save());
+        }
+
+        EXPECT_TRUE(sm->getBackend().flush());
+
+        // 100 records of /a would be way larger than this
+        EXPECT_LT(fs::file_size("files/out.log.compaction.json"), 512);
+    }
+
+    {
+        auto sm = makeManager();
+
+        EXPECT_EQ(SettingManager::LoadError::NoError,
+                  sm->load("files/out.log.compaction.json"));
+
+        Setting<int> a("/a", SettingOption::Default, sm);
+        Setting<int> b("/b", SettingOption::Default, sm);
+
+        EXPECT_EQ(a.getValue(), 99);
+        EXPECT_EQ(b.getValue(), 1);
+    }
+}
+
+TEST(LogBackend, SavesDuringCompaction)
+{
+    RemoveFile("files/out.log.concurrent.json");
+
+    constexpr int numSaves = 500;
+
+    {
+        auto sm = makeManager(256);
+        sm->setDurability(Backup::Durability::SyncFile);
+        sm->setPath("files/out.log.concurrent.json");
+
+        Setting<int> a("/a", SettingOption::Default, sm);
+        Setting<std::string> b("/b/c", SettingOption::Default, sm);
+
+        // Compactions copy the live records while these keep appending
+        for (int i = 1; i <= numSaves; ++i) {
+            a = i;
+            b = std::string(static_cast<std::size_t>(i % 32), 'x');
+            EXPECT_EQ(SaveResult::Success, sm->save());
+        }
+
+        EXPECT_TRUE(sm->getBackend().flush());
+        EXPECT_FALSE(fs::exists("files/out.log.concurrent.json.compact"));
+    }
+
+    {
+        auto sm = makeManager();
+
+        EXPECT_EQ(SettingManager::LoadError::NoError,
+                  sm->load("files/out.log.concurrent.json"));
+
+        Setting<int> a("/a", SettingOption::Default, sm);
+        Setting<std::string> b("/b/c", SettingOption::Default, sm);
+
+        EXPECT_EQ(a.getValue(), numSaves);
+        EXPECT_EQ(b.getValue(), std::string(numSaves % 32, 'x'));
+    }
+}
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+
+#include <pajlada/settings.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common.hpp"
+
+using namespace pajlada::Settings;
+using namespace pajlada;
+
+namespace {
+
+using Changes = std::vector<std::pair<std::string, std::string>>;
+
+SettingManager::PrefixCallback
+record(Changes &changes)
+{
+    return [&changes](const std::string &path, const rapidjson::Value &value,
+                      const SignalArgs &) {
+        changes.emplace_back(path, SettingManager::stringify(value));
+    };
+}
+
+}  // namespace
+
+TEST(Prefix, ChildrenAndParents)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    Changes channels;
+    Changes forsen;
+    Signals::ScopedConnection c1(
+        sm->connectPrefix("/channels/", record(channels)));
+    Signals::ScopedConnection c2(
+        sm->connectPrefix("/channels/forsen", record(forsen)));
+
+    Setting<int> a("/channels/forsen/volume", SettingOption::Default, sm);
+    Setting<int> b("/channels/pajlada/volume", SettingOption::Default, sm);
+    Setting<int> c("/other", SettingOption::Default, sm);
+
+    a = 5;
+    b = 6;
+    c = 7;
+
+    EXPECT_EQ(channels, (Changes{{"/channels/forsen/volume", "5"},
+                                 {"/channels/pajlada/volume", "6"}}));
+    EXPECT_EQ(forsen, (Changes{{"/channels/forsen/volume", "5"}}));
+
+    channels.clear();
+    forsen.clear();
+
+    // Setting a parent notifies the subscription below it with its own part
+    rapidjson::Document d;
+    d.Parse(R"({"pajlada": {"volume": 1}})");
+    sm->set("/channels", d);
+
+    EXPECT_EQ(channels,
+              (Changes{{"/channels", R"({"pajlada":{"volume":1}})"}}));
+    EXPECT_EQ(forsen, (Changes{{"/channels/forsen", "null"}}));
+}
+
+TEST(Prefix, Disconnect)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    Changes changes;
+
+    {
+        Signals::ScopedConnection connection(
+            sm->connectPrefix("/a", record(changes)));
+
+        rapidjson::Value v(1);
+        sm->set("/a/b", v);
+    }
+
+    rapidjson::Value v(2);
+    sm->set("/a/b", v);
+
+    EXPECT_EQ(changes, (Changes{{"/a/b", "1"}}));
+}
@@ -0,0 +1,239 @@
+#include <gtest/gtest.h>
+
+#ifndef _WIN32
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <pajlada/settings.hpp>
+#include <pajlada/settings/remote.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common.hpp"
+
+using namespace pajlada::Settings;
+
+namespace {
+
+bool
+WaitFor(const std::function<bool()> &condition)
+{
+    for (int i = 0; i < 200; ++i) {
+        if (condition()) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    return condition();
+}
+
+// A client that speaks the wire format by hand
+int
+ConnectRaw(const std::string &socketPath)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&address),
+                  sizeof(address)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+void
+SendFrame(int fd, std::uint32_t length, const std::string &json)
+{
+    std::string frame(sizeof(length), '\0');
+    std::memcpy(frame.data(), &length, sizeof(length));
+    frame += json;
+
+    ASSERT_EQ(::send(fd, frame.data(), frame.size(), 0),
+              static_cast<ssize_t>(frame.size()));
+}
+
+// Returns true once the server has closed the connection
+bool
+WaitForClose(int fd)
+{
+    timeval timeout{.tv_sec = 2, .tv_usec = 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    char buffer[4096];
+    while (true) {
+        auto n = ::read(fd, buffer, sizeof(buffer));
+        if (n == 0) {
+            return true;
+        }
+        if (n < 0) {
+            return false;
+        }
+    }
+}
+
+}  // namespace
+
+TEST(Remote, DropsBadClients)
+{
+    auto owner = std::make_shared<SettingManager>();
+    owner->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    Setting<int> ownerValue("/value", SettingOption::Default, owner);
+    ownerValue = 5;
+
+    RemoteServer server(owner, "files/out.remote-bad.sock");
+    ASSERT_TRUE(server.isRunning());
+
+    // A path that's not a JSON pointer
+    int fd = ConnectRaw("files/out.remote-bad.sock");
+    ASSERT_GE(fd, 0);
+    std::string json = R"([["value", 6]])";
+    SendFrame(fd, static_cast<std::uint32_t>(json.size()), json);
+    EXPECT_TRUE(WaitForClose(fd));
+    ::close(fd);
+
+    // A frame that's too long to be buffered
+    fd = ConnectRaw("files/out.remote-bad.sock");
+    ASSERT_GE(fd, 0);
+    SendFrame(fd, UINT32_MAX, "[");
+    EXPECT_TRUE(WaitForClose(fd));
+    ::close(fd);
+
+    EXPECT_EQ(ownerValue.getValue(), 5);
+}
+
+TEST(Remote, Sync)
+{
+    auto owner = std::make_shared<SettingManager>();
+    owner->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    Setting<int> ownerValue("/value", SettingOption::Default, owner);
+    ownerValue = 5;
+
+    RemoteServer server(owner, "files/out.remote.sock");
+    ASSERT_TRUE(server.isRunning());
+
+    auto mirror = std::make_shared<SettingManager>();
+
+    std::atomic<int> mirroredValue = 0;
+    std::atomic<int> mirrorCalls = 0;
+    Setting<int> value("/value", SettingOption::Remote, mirror);
+    value.connect(
+        [&](int v) {
+            mirroredValue = v;
+            ++mirrorCalls;
+        },
+        false);
+
+    RemoteClient client(mirror, "files/out.remote.sock");
+    ASSERT_TRUE(client.isConnected());
+
+    // The client starts off with the full document
+    EXPECT_TRUE(WaitFor([&] {
+        return mirroredValue == 5;
+    }));
+
+    // Values set in the owner are sent to the client
+    ownerValue = 6;
+    EXPECT_TRUE(WaitFor([&] {
+        return mirroredValue == 6;
+    }));
+
+    // Remote settings are set in the owner and echoed back
+    int callsBefore = mirrorCalls;
+    value = 7;
+    EXPECT_TRUE(WaitFor([&] {
+        return mirroredValue == 7;
+    }));
+    EXPECT_EQ(mirrorCalls, callsBefore + 1);
+    EXPECT_TRUE(WaitFor([&] {
+        return ownerValue.getValue() == 7;
+    }));
+}
+
+TEST(Remote, ConcurrentSetsConverge)
+{
+    auto owner = std::make_shared<SettingManager>();
+    owner->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    Setting<int> ownerValue("/value", SettingOption::Default, owner);
+
+    RemoteServer server(owner, "files/out.remote-order.sock");
+    ASSERT_TRUE(server.isRunning());
+
+    auto mirror = std::make_shared<SettingManager>();
+    Setting<int> value("/value", SettingOption::Remote, mirror);
+
+    RemoteClient client(mirror, "files/out.remote-order.sock");
+    ASSERT_TRUE(client.isConnected());
+
+    constexpr int numThreads = 4;
+    constexpr int numSets = 500;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; ++i) {
+        threads.emplace_back([&, i] {
+            Setting<int> setter("/value", SettingOption::Default, owner);
+            for (int j = 0; j < numSets; ++j) {
+                setter = i * numSets + j;
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    // Whichever set was applied last, the mirror ends up with it too
+    EXPECT_TRUE(WaitFor([&] {
+        return value.getValue() == ownerValue.getValue();
+    }));
+}
+
+TEST(Remote, StalledClient)
+{
+    auto owner = std::make_shared<SettingManager>();
+    owner->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    Setting<std::string> ownerValue("/value", SettingOption::Default, owner);
+
+    RemoteServer server(owner, "files/out.remote-stalled.sock");
+    ASSERT_TRUE(server.isRunning());
+
+    // Connects, but never reads anything
+    int stalled = ConnectRaw("files/out.remote-stalled.sock");
+    ASSERT_GE(stalled, 0);
+
+    auto mirror = std::make_shared<SettingManager>();
+    Setting<std::string> value("/value", SettingOption::Default, mirror);
+
+    RemoteClient client(mirror, "files/out.remote-stalled.sock");
+    ASSERT_TRUE(client.isConnected());
+
+    // Much more than the socket buffers of the stalled client hold
+    for (int i = 0; i < 64; ++i) {
+        ownerValue = std::string(256 * 1024, static_cast<char>('a' + i % 26));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ownerValue = "done";
+
+    EXPECT_TRUE(WaitFor([&] {
+        return value.getValue() == "done";
+    }));
+
+    ::close(stalled);
+}
+
+#endif
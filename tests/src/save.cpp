@@ -95,6 +95,36 @@ TEST(Save, ErrorOnSymlinkPointingToNonexistantFile)
     EXPECT_TRUE(!ec);
 }
 
+TEST(Save, CachedRealPath)
+{
+    std::string link("files/out.cached-realpath.json");
+    std::string target1("files/out.cached-realpath.target1.json");
+    std::string target2("files/out.cached-realpath.target2.json");
+
+    RemoveFile(link);
+    fs::create_symlink(fs::path(target1).filename(), link);
+
+    std::error_code ec;
+    detail::RealPathCache cache;
+
+    EXPECT_EQ(cache.resolve(link, ec), target1);
+    EXPECT_TRUE(!ec);
+
+    // Cached paths are not looked at again until the cache is cleared
+    RemoveFile(link);
+    fs::create_symlink(fs::path(target2).filename(), link);
+
+    EXPECT_EQ(cache.resolve(link, ec), target1);
+    EXPECT_TRUE(!ec);
+
+    cache.clear();
+
+    EXPECT_EQ(cache.resolve(link, ec), target2);
+    EXPECT_TRUE(!ec);
+
+    RemoveFile(link);
+}
+
 TEST(Save, Backup)
 {
     auto sm = std::make_shared<SettingManager>();
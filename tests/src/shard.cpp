@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+
+#include <pajlada/settings.hpp>
+
+#include "common.hpp"
+
+using namespace pajlada::Settings;
+using SaveResult = pajlada::Settings::SettingManager::SaveResult;
+
+namespace fs = std::filesystem;
+
+TEST(Shard, OnlyDirtyShardsAreRewritten)
+{
+    RemoveFile("files/out.shard.json");
+    RemoveFile("files/out.shard.json.bkp-1");
+    RemoveFile("files/out.shard.json.bkp-2");
+    RemoveFile("files/out.shard.highlights.json");
+    RemoveFile("files/out.shard.highlights.json.bkp-1");
+
+    {
+        auto sm = std::make_shared<SettingManager>();
+        sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+        sm->setPath("files/out.shard.json");
+        sm->addShard("/highlights", "out.shard.highlights.json");
+
+        Setting<int> geometry("/window/geometry", SettingOption::Default, sm);
+        Setting<std::string> highlight("/highlights/a", SettingOption::Default,
+                                       sm);
+
+        geometry = 5;
+        highlight = "forsen";
+
+        EXPECT_EQ(SaveResult::Success, sm->save());
+
+        EXPECT_TRUE(fs::exists("files/out.shard.json"));
+        EXPECT_TRUE(fs::exists("files/out.shard.highlights.json"));
+        EXPECT_EQ(ReadFile("files/out.shard.json").find("forsen"),
+                  std::string::npos);
+
+        geometry = 6;
+
+        EXPECT_EQ(SaveResult::Success, sm->save());
+
+        // Only the main file has changed
+        EXPECT_TRUE(fs::exists("files/out.shard.json.bkp-1"));
+        EXPECT_FALSE(fs::exists("files/out.shard.highlights.json.bkp-1"));
+
+        auto mainFile = ReadFile("files/out.shard.json");
+
+        highlight = "xd";
+
+        EXPECT_EQ(SaveResult::Success, sm->save());
+
+        EXPECT_TRUE(fs::exists("files/out.shard.highlights.json.bkp-1"));
+
+        // Only the shard has changed, the main file and its backups are left
+        // alone
+        EXPECT_EQ(ReadFile("files/out.shard.json"), mainFile);
+        EXPECT_FALSE(fs::exists("files/out.shard.json.bkp-2"));
+    }
+
+    {
+        auto sm = std::make_shared<SettingManager>();
+        sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+        sm->addShard("/highlights", "out.shard.highlights.json");
+
+        EXPECT_EQ(SettingManager::LoadError::NoError,
+                  sm->load("files/out.shard.json"));
+
+        Setting<int> geometry("/window/geometry", SettingOption::Default, sm);
+        Setting<std::string> highlight("/highlights/a", SettingOption::Default,
+                                       sm);
+
+        EXPECT_EQ(geometry.getValue(), 6);
+        EXPECT_EQ(highlight.getValue(), "xd");
+    }
+}
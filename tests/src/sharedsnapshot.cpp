@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+
+#ifndef _WIN32
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <pajlada/settings.hpp>
+#include <pajlada/settings/sharedsnapshot.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "common.hpp"
+
+using namespace pajlada::Settings;
+
+namespace {
+
+// Refresh `reader` until it has mapped a generation newer than `generation`
+bool
+waitForNewerGeneration(SharedSnapshotReader &reader, std::uint64_t generation)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (reader.refresh() && reader.generation() > generation) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return false;
+}
+
+// Create the shared memory segment `name` containing `data`
+void
+writeSegment(const std::string &name, const void *data, std::size_t size)
+{
+    int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(::write(fd, data, size), static_cast<ssize_t>(size));
+    ::close(fd);
+}
+
+}  // namespace
+
+TEST(SharedSnapshot, PublishAndRead)
+{
+    auto name = "/pajlada-settings-test-" + std::to_string(::getpid());
+
+    auto owner = std::make_shared<SettingManager>();
+    owner->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    Setting<int> a("/a", SettingOption::Default, owner);
+    Setting<std::vector<std::string>> list("/nested/list",
+                                           SettingOption::Default, owner);
+    a = 5;
+    list = std::vector<std::string>{"a", "b"};
+
+    SharedSnapshotPublisher publisher(owner, name);
+
+    SharedSnapshotReader reader(name);
+    ASSERT_TRUE(reader.refresh());
+    EXPECT_EQ(reader.generation(), publisher.generation());
+
+    EXPECT_EQ(reader.get<int>("/a"), 5);
+    EXPECT_EQ(reader.get<std::vector<std::string>>("/nested/list"),
+              (std::vector<std::string>{"a", "b"}));
+    EXPECT_EQ(reader.get<int>("/missing"), std::nullopt);
+
+    // Settings of another manager can be resolved from the snapshot
+    auto readerManager = std::make_shared<SettingManager>();
+    readerManager->saveMethod = SettingManager::SaveMethod::SaveManually;
+    Setting<int> readerA("/a", SettingOption::Default, readerManager);
+    EXPECT_EQ(readerA.getValue(reader), 5);
+
+    // The reader keeps its snapshot until it refreshes
+    auto oldGeneration = reader.generation();
+    a = 6;
+    EXPECT_EQ(reader.get<int>("/a"), 5);
+
+    ASSERT_TRUE(waitForNewerGeneration(reader, oldGeneration));
+    EXPECT_EQ(reader.get<int>("/a"), 6);
+}
+
+TEST(SharedSnapshot, CoalescesPublishes)
+{
+    auto name = "/pajlada-settings-test-coalesce-" + std::to_string(::getpid());
+
+    auto owner = std::make_shared<SettingManager>();
+    owner->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    Setting<int> a("/a", SettingOption::Default, owner);
+
+    SharedSnapshotPublisher publisher(owner, name, true,
+                                      std::chrono::milliseconds(50));
+    auto firstGeneration = publisher.generation();
+
+    constexpr int numSets = 1000;
+    for (int i = 1; i <= numSets; ++i) {
+        a = i;
+    }
+
+    SharedSnapshotReader reader(name);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while ((!reader.refresh() || reader.get<int>("/a") != numSets) &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    EXPECT_EQ(reader.get<int>("/a"), numSets);
+    EXPECT_LT(reader.generation() - firstGeneration, 10);
+}
+
+TEST(SharedSnapshot, RejectsCorruptEntries)
+{
+    auto name = "/pajlada-settings-test-corrupt-" + std::to_string(::getpid());
+
+    // Same layout as the segments written by SharedSnapshotPublisher
+    struct {
+        char magic[8] = {'P', 'S', 'S', 'N', 'A', 'P', '0', '2'};
+        std::uint64_t generation = 1;
+        std::uint64_t entryCount = 1;
+        std::uint64_t size = 0;
+        std::uint64_t pathOffset = 64;
+        std::uint64_t pathLength = 2;
+        std::uint64_t valueOffset = 1ULL << 40;
+        std::uint64_t valueLength = 1;
+        char strings[2] = {'/', 'a'};
+    } snapshot;
+    snapshot.size = sizeof(snapshot);
+
+    std::uint64_t generation = 1;
+    writeSegment(name, &generation, sizeof(generation));
+    writeSegment(name + ".1", &snapshot, sizeof(snapshot));
+
+    SharedSnapshotReader reader(name);
+    ASSERT_TRUE(reader.refresh());
+
+    rapidjson::Document out;
+    EXPECT_FALSE(reader.getJSON("/a", out));
+
+    ::shm_unlink(name.c_str());
+    ::shm_unlink((name + ".1").c_str());
+}
+
+TEST(SharedSnapshot, SiblingsSortingBetweenChildren)
+{
+    auto name = "/pajlada-settings-test-siblings-" + std::to_string(::getpid());
+
+    auto owner = std::make_shared<SettingManager>();
+    owner->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    // '-' and '.' sort before '/', these must not end up between "/a" and
+    // its children
+    Setting<int> x("/a/x", SettingOption::Default, owner);
+    Setting<int> y("/a/y", SettingOption::Default, owner);
+    Setting<int> dash("/a-b", SettingOption::Default, owner);
+    Setting<int> dot("/a.c", SettingOption::Default, owner);
+    x = 1;
+    y = 2;
+    dash = 3;
+    dot = 4;
+
+    SharedSnapshotPublisher publisher(owner, name, false);
+
+    SharedSnapshotReader reader(name);
+    ASSERT_TRUE(reader.refresh());
+
+    rapidjson::Document a;
+    ASSERT_TRUE(reader.getJSON("/a", a));
+    ASSERT_TRUE(a.IsObject());
+    EXPECT_EQ(a.MemberCount(), 2);
+    EXPECT_EQ(reader.get<int>("/a/x"), 1);
+    EXPECT_EQ(reader.get<int>("/a/y"), 2);
+    EXPECT_EQ(reader.get<int>("/a-b"), 3);
+    EXPECT_EQ(reader.get<int>("/a.c"), 4);
+
+    rapidjson::Document root;
+    ASSERT_TRUE(reader.getJSON("", root));
+    EXPECT_EQ(root.MemberCount(), 3);
+}
+
+#endif
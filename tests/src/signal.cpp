@@ -2,6 +2,48 @@
 
 using namespace pajlada::Settings;
 
+namespace {
+
+int numDeserializations = 0;
+
+struct CountedValue {
+    int value = 0;
+
+    bool
+    operator==(const CountedValue &other) const
+    {
+        return this->value == other.value;
+    }
+};
+
+}  // namespace
+
+namespace pajlada {
+
+template <>
+struct Serialize<CountedValue> {
+    static rapidjson::Value
+    get(const CountedValue &value, rapidjson::Document::AllocatorType &a)
+    {
+        return Serialize<int>::get(value.value, a);
+    }
+};
+
+template <>
+struct Deserialize<CountedValue> {
+    static CountedValue
+    get(const rapidjson::Value &value, bool *error = nullptr)
+    {
+        ++numDeserializations;
+
+        return CountedValue{
+            .value = Deserialize<int>::get(value, error),
+        };
+    }
+};
+
+}  // namespace pajlada
+
 TEST(Signal, Simple)
 {
     int count = 0;
@@ -152,3 +194,49 @@ TEST(Signal, ScopedConnection2)
         EXPECT_TRUE(count == 5);
     }
 }
+
+TEST(Signal, DeserializeOncePerNotification)
+{
+    Setting<CountedValue> a("/signal/deserialize_once");
+    Setting<CountedValue> b("/signal/deserialize_once");
+
+    int sum = 0;
+    for (int i = 0; i < 5; ++i) {
+        a.connect(
+            [&sum](const CountedValue &v) {
+                sum += v.value;
+            },
+            false);
+        b.connect(
+            [&sum](const CountedValue &v, const auto &) {
+                sum += v.value;
+            },
+            false);
+    }
+
+    numDeserializations = 0;
+
+    a = CountedValue{.value = 3};
+
+    EXPECT_EQ(sum, 30);
+    EXPECT_EQ(numDeserializations, 1);
+
+    // The getValue cache of other settings reuses the notified value
+    EXPECT_EQ(b.getValue().value, 3);
+    EXPECT_EQ(numDeserializations, 1);
+}
+
+TEST(Signal, GetValueReferenceOutlivesUpdates)
+{
+    Setting<std::vector<int>> a("/signal/reference_outlives_updates");
+    a.setValue({1, 2, 3});
+
+    const auto &value = a.getValue();
+
+    a.setValue({4, 5});
+    a.push_back(6);
+
+    // The reference points at the setting's own storage, not at a value
+    // that was replaced
+    EXPECT_EQ(value, (std::vector<int>{4, 5, 6}));
+}
@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include <pajlada/settings.hpp>
+#include <pajlada/settings/snapshot.hpp>
+#include <pajlada/settings/transaction.hpp>
+
+#include <atomic>
+#include <thread>
+
+using namespace pajlada::Settings;
+
+TEST(Snapshot, Immutable)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    Setting<int> a("/snapshot/a", SettingOption::Default, sm);
+    Setting<std::string> b("/snapshot/b", SettingOption::Default, sm);
+
+    EXPECT_TRUE(Snapshot().empty());
+
+    a = 1;
+    b = "forsen";
+
+    auto first = sm->snapshot();
+    EXPECT_FALSE(first.empty());
+    EXPECT_EQ(a.getValue(first), 1);
+    EXPECT_EQ(b.getValue(first), "forsen");
+
+    a = 2;
+    b = "xqc";
+
+    auto second = sm->snapshot();
+    EXPECT_EQ(a.getValue(first), 1);
+    EXPECT_EQ(b.getValue(first), "forsen");
+    EXPECT_EQ(a.getValue(second), 2);
+    EXPECT_EQ(b.getValue(second), "xqc");
+
+    sm->set("/snapshot/c/d", rapidjson::Value(5));
+
+    auto third = sm->snapshot();
+    EXPECT_EQ(third.get<int>("/snapshot/c/d"), 5);
+    EXPECT_EQ(third.get<std::string>("/snapshot/b"), "xqc");
+    EXPECT_FALSE(second.get<int>("/snapshot/c/d"));
+}
+
+TEST(Snapshot, Restore)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    Setting<int> a("/restore/a", SettingOption::Default, sm);
+    Setting<int> b("/restore/b", SettingOption::Default, sm);
+
+    a = 1;
+    b = 2;
+
+    auto saved = sm->snapshot();
+
+    a = 3;
+
+    int aCalls = 0;
+    int bCalls = 0;
+    std::vector<std::unique_ptr<pajlada::Signals::ScopedConnection>>
+        connections;
+    a.connect(
+        [&](int, const SignalArgs &) {
+            ++aCalls;
+        },
+        connections, false);
+    b.connect(
+        [&](int, const SignalArgs &) {
+            ++bCalls;
+        },
+        connections, false);
+
+    sm->restore(saved);
+
+    EXPECT_EQ(a.getValue(), 1);
+    EXPECT_EQ(b.getValue(), 2);
+    EXPECT_EQ(aCalls, 1);
+    EXPECT_EQ(bCalls, 0);
+}
+
+TEST(Snapshot, ConsistentReads)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    Setting<int> port("/proxy/port", SettingOption::Default, sm);
+    Setting<int> copy("/proxy/portCopy", SettingOption::Default, sm);
+
+    auto empty = sm->snapshot();
+
+    std::atomic<bool> done = false;
+    std::thread writer([&] {
+        for (int i = 1; i <= 2000; ++i) {
+            sm->transaction([&](Transaction &transaction) {
+                transaction.setValue(port, i);
+                transaction.setValue(copy, i);
+            });
+        }
+        done = true;
+    });
+
+    std::uint64_t lastVersion = empty.version();
+    while (!done) {
+        auto view = sm->snapshot();
+        EXPECT_GE(view.version(), lastVersion);
+        lastVersion = view.version();
+
+        EXPECT_EQ(port.getValue(view), copy.getValue(view));
+    }
+
+    writer.join();
+
+    auto last = sm->snapshot();
+    EXPECT_EQ(port.getValue(last), 2000);
+    EXPECT_EQ(copy.getValue(last), 2000);
+    EXPECT_EQ(port.getValue(empty), 0);
+}
@@ -0,0 +1,246 @@
+#include <gtest/gtest.h>
+
+#include <pajlada/settings.hpp>
+#include <pajlada/settings/backend.hpp>
+#include <pajlada/settings/transaction.hpp>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+
+using namespace pajlada::Settings;
+
+namespace {
+
+class CountingBackend : public Backend
+{
+public:
+    LoadError
+    load(const std::filesystem::path & /*path*/,
+         rapidjson::Document & /*document*/) override
+    {
+        return LoadError::NoError;
+    }
+
+    bool
+    persist(const std::filesystem::path & /*path*/,
+            const rapidjson::Document & /*document*/,
+            const PersistRequest & /*request*/) override
+    {
+        ++this->persists;
+
+        if (this->onPersist) {
+            this->onPersist();
+        }
+
+        if (this->fail) {
+            throw std::runtime_error("disk on fire");
+        }
+
+        return true;
+    }
+
+    int persists = 0;
+    bool fail = false;
+    std::function<void()> onPersist;
+};
+
+}  // namespace
+
+TEST(Transaction, SingleSaveAndWave)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveOnSettingChange;
+
+    auto backend = std::make_unique<CountingBackend>();
+    auto *countingBackend = backend.get();
+    sm->setBackend(std::move(backend));
+
+    Setting<int> a("/a", SettingOption::Default, sm);
+    Setting<int> b("/b/c", SettingOption::Default, sm);
+
+    // Observers only ever see the fully applied transaction
+    std::vector<std::pair<int, int>> seen;
+    a.connect(
+        [&](const int &value) {
+            seen.emplace_back(value, b.getValue());
+        },
+        false);
+    b.connect(
+        [&](const int &value) {
+            seen.emplace_back(a.getValue(), value);
+        },
+        false);
+
+    Transaction transaction(*sm);
+    transaction.setValue(a, 1);
+    transaction.setValue(b, 2);
+    transaction.setValue(a, 3);
+
+    EXPECT_EQ(a.getValue(), 0);
+    EXPECT_EQ(countingBackend->persists, 0);
+
+    transaction.commit();
+
+    EXPECT_TRUE(transaction.empty());
+    EXPECT_EQ(a.getValue(), 3);
+    EXPECT_EQ(b.getValue(), 2);
+    EXPECT_EQ(countingBackend->persists, 1);
+    EXPECT_EQ(seen,
+              (std::vector<std::pair<int, int>>{{3, 2}, {3, 2}}));
+}
+
+TEST(Transaction, Discard)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    Setting<int> a("/a", SettingOption::Default, sm);
+
+    {
+        Transaction transaction(*sm);
+        transaction.setValue(a, 1);
+    }
+
+    EXPECT_EQ(a.getValue(), 0);
+
+    EXPECT_THROW(sm->transaction([&](Transaction &transaction) {
+        transaction.setValue(a, 2);
+        throw std::runtime_error("changed my mind");
+    }),
+                 std::runtime_error);
+
+    EXPECT_EQ(a.getValue(), 0);
+
+    sm->transaction([&](Transaction &transaction) {
+        transaction.setValue(a, 3);
+    });
+
+    EXPECT_EQ(a.getValue(), 3);
+}
+
+TEST(Transaction, RollbackOnException)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveOnSettingChange;
+
+    auto backend = std::make_unique<CountingBackend>();
+    auto *countingBackend = backend.get();
+    sm->setBackend(std::move(backend));
+
+    Setting<int> a("/a", SettingOption::Default, sm);
+    Setting<int> c("/b/c", SettingOption::Default, sm);
+    a = 1;
+
+    int notifications = 0;
+    c.connect(
+        [&] {
+            ++notifications;
+        },
+        false);
+
+    countingBackend->fail = true;
+
+    Transaction transaction(*sm);
+    transaction.setValue(a, 2);
+    transaction.setValue(c, 2);
+    EXPECT_THROW(transaction.commit(), std::runtime_error);
+
+    EXPECT_EQ(a.getValue(), 1);
+    EXPECT_EQ(c.getValue(), 0);
+    // Objects created by the transaction are removed again
+    EXPECT_EQ(sm->get("/b"), nullptr);
+    EXPECT_EQ(notifications, 0);
+}
+
+TEST(Transaction, RollbackKeepsLaterWrites)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveOnSettingChange;
+
+    auto backend = std::make_unique<CountingBackend>();
+    auto *countingBackend = backend.get();
+    sm->setBackend(std::move(backend));
+
+    Setting<int> a("/a", SettingOption::Default, sm);
+    Setting<int> b("/b", SettingOption::Default, sm);
+    Setting<int> c("/n/c", SettingOption::Default, sm);
+    Setting<int> d("/n/d", SettingOption::Default, sm);
+    a = 1;
+    b = 1;
+
+    countingBackend->fail = true;
+    countingBackend->onPersist = [&] {
+        // Someone else writes between the transaction being applied and
+        // being saved
+        sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+        b = 10;
+        d = 10;
+    };
+
+    Transaction transaction(*sm);
+    transaction.setValue(a, 2);
+    transaction.setValue(b, 2);
+    transaction.setValue(c, 2);
+    EXPECT_THROW(transaction.commit(), std::runtime_error);
+
+    EXPECT_EQ(a.getValue(), 1);
+    EXPECT_EQ(b.getValue(), 10);
+    // The object created by the transaction has a value of someone else now
+    EXPECT_EQ(c.getValue(), 0);
+    EXPECT_EQ(sm->get("/n/c"), nullptr);
+    EXPECT_EQ(d.getValue(), 10);
+}
+
+TEST(Transaction, SettingOptions)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveOnSettingChange;
+
+    auto backend = std::make_unique<CountingBackend>();
+    auto *countingBackend = backend.get();
+    sm->setBackend(std::move(backend));
+
+    Setting<int> local("/local", SettingOption::DoNotWriteToJSON, sm);
+    Setting<int> compared("/compared", SettingOption::CompareBeforeSet, sm);
+    Setting<int> remote("/remote", SettingOption::Remote, sm);
+    compared = 1;
+
+    int comparedNotifications = 0;
+    compared.connect(
+        [&] {
+            ++comparedNotifications;
+        },
+        false);
+
+    std::vector<std::string> sentPaths;
+    sm->setRemoteWriter(
+        [&](const std::string &path, const rapidjson::Value &value) {
+            sentPaths.push_back(path);
+            EXPECT_EQ(value.GetInt(), 3);
+        });
+
+    auto persistsBefore = countingBackend->persists;
+
+    Transaction transaction(*sm);
+    transaction.setValue(local, 2);
+    transaction.setValue(compared, 1);
+    transaction.setValue(remote, 3);
+    transaction.commit();
+
+    // Kept out of the document, but the setting has it
+    EXPECT_EQ(local.getValue(), 2);
+    EXPECT_EQ(sm->get("/local"), nullptr);
+
+    // Unchanged, so not written, saved or notified
+    EXPECT_EQ(comparedNotifications, 0);
+    EXPECT_EQ(countingBackend->persists, persistsBefore);
+
+    // Sent to the owner instead of being set here
+    EXPECT_EQ(sentPaths, std::vector<std::string>{"/remote"});
+    EXPECT_EQ(sm->get("/remote"), nullptr);
+
+    sm->setRemoteWriter({});
+}
@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+
+#include <pajlada/settings.hpp>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+using namespace pajlada::Settings;
+
+TEST(Update, CompareExchange)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    Setting<int> a("/update/a", 5, SettingOption::Default, sm);
+
+    // No value yet, compared with the default value
+    int expected = 4;
+    EXPECT_FALSE(a.compareExchange(expected, 6));
+    EXPECT_EQ(expected, 5);
+
+    EXPECT_TRUE(a.compareExchange(expected, 6));
+    EXPECT_EQ(a.getValue(), 6);
+
+    EXPECT_FALSE(a.compareExchange(expected, 7));
+    EXPECT_EQ(expected, 6);
+    EXPECT_EQ(a.getValue(), 6);
+}
+
+TEST(Update, Concurrent)
+{
+    auto sm = std::make_shared<SettingManager>();
+    sm->saveMethod = SettingManager::SaveMethod::SaveManually;
+
+    Setting<int> counter("/update/counter", SettingOption::Default, sm);
+    Setting<std::vector<int>> recent("/update/recent", SettingOption::Default,
+                                     sm);
+
+    constexpr int numThreads = 4;
+    constexpr int numUpdates = 250;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; ++i) {
+        threads.emplace_back([&, i] {
+            for (int j = 0; j < numUpdates; ++j) {
+                auto next = counter.update([](const int &value) {
+                    return value + 1;
+                });
+                EXPECT_TRUE(next.has_value());
+
+                recent.push_back(i * numUpdates + j);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(counter.getValue(), numThreads * numUpdates);
+
+    auto values = recent.getValue();
+    ASSERT_EQ(values.size(), numThreads * numUpdates);
+    std::sort(values.begin(), values.end());
+    for (int i = 0; i < numThreads * numUpdates; ++i) {
+        EXPECT_EQ(values[i], i);
+    }
+
+    recent.removeByValue(0);
+    EXPECT_EQ(recent.getValue().size(), numThreads * numUpdates - 1);
+}
@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <coroutine>
+#include <optional>
+#include <pajlada/settings.hpp>
+#include <thread>
+
+using namespace pajlada::Settings;
+
+namespace {
+
+// Minimal eagerly started coroutine, destroyed with its owner
+struct Task {
+    struct promise_type {
+        Task
+        get_return_object()
+        {
+            return Task{
+                std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_never
+        initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_always
+        final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void
+        return_void()
+        {
+        }
+
+        void
+        unhandled_exception()
+        {
+            std::terminate();
+        }
+    };
+
+    explicit Task(std::coroutine_handle<promise_type> _handle)
+        : handle(_handle)
+    {
+    }
+
+    ~Task()
+    {
+        this->handle.destroy();
+    }
+
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    bool
+    done() const
+    {
+        return this->handle.done();
+    }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+Task
+awaitLarge(Setting<int> &setting, std::optional<int> &result)
+{
+    result = co_await setting.nextValue([](const int &value) {
+        return value > 2;
+    });
+}
+
+Task
+awaitChange(Setting<int> &setting, std::optional<int> &result)
+{
+    result = co_await setting.changed();
+}
+
+}  // namespace
+
+TEST(Wait, NextValue)
+{
+    auto sm = std::make_shared<SettingManager>();
+    Setting<int> setting("/wait/next", SettingOption::Default, sm);
+
+    std::optional<int> result;
+    Task task = awaitLarge(setting, result);
+
+    EXPECT_FALSE(task.done());
+
+    setting = 1;
+    setting = 2;
+    EXPECT_FALSE(task.done());
+
+    setting = 3;
+    EXPECT_TRUE(task.done());
+    EXPECT_EQ(result, 3);
+
+    // Done waiting, nothing happens anymore
+    setting = 4;
+    EXPECT_EQ(result, 3);
+}
+
+TEST(Wait, DestroyedWhileWaiting)
+{
+    auto sm = std::make_shared<SettingManager>();
+    Setting<int> setting("/wait/destroyed", SettingOption::Default, sm);
+
+    std::optional<int> result;
+    {
+        Task task = awaitChange(setting, result);
+        EXPECT_FALSE(task.done());
+    }
+
+    // The awaiter disconnected when the coroutine was destroyed
+    setting = 1;
+    EXPECT_FALSE(result.has_value());
+}
+
+TEST(Wait, WaitFor)
+{
+    auto sm = std::make_shared<SettingManager>();
+    Setting<int> setting("/wait/blocking", SettingOption::Default, sm);
+
+    auto isFive = [](const int &value) {
+        return value == 5;
+    };
+
+    EXPECT_EQ(setting.waitFor(isFive, std::chrono::milliseconds(10)),
+              std::nullopt);
+
+    std::thread setter([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        setting = 4;
+        setting = 5;
+    });
+
+    EXPECT_EQ(setting.waitFor(isFive, std::chrono::seconds(5)), 5);
+
+    setter.join();
+
+    // Already matching
+    EXPECT_EQ(setting.waitFor(isFive, std::chrono::milliseconds(0)), 5);
+}